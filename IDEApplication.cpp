@@ -36,23 +36,35 @@ This program is free software; you can redistribute it and/or modify
 #include <QDebug>
 
 #include "plugins/IDEPluginInterface.h"
+#include "env/CommandLine.h"
 
 #include <QTextCursor>
 #include <QTextCharFormat>
+#include "env/Diagnostic.h"
 void IDEApplication::registerMetaTypes()
 {
     qRegisterMetaType<QTextCursor>("QTextCursor");
     qRegisterMetaType<QTextCharFormat>("QTextCharFormat");
+    qRegisterMetaType<Diagnostic>("Diagnostic");
+    qRegisterMetaType<QList<Diagnostic> >("QList<Diagnostic>");
+    qRegisterMetaType<qint64>("qint64");
 }
 
 IDEApplication::IDEApplication(int& argc, char **argv)
-    : QApplication(argc, argv),
-      mSettings(NULL)
+    : QApplication(argc, argv, ! CommandLine::isRequested(argc, argv)),
+      mGui(! CommandLine::isRequested(argc, argv)),
+      mMainWindow(NULL),
+      mEngine(NULL),
+      mPluginLoader(NULL),
+      mProjectHistory(NULL),
+      mSettings(NULL),
+      mLibraryIndex(NULL)
 {
     setOrganizationName(PROJECT_ORGANIZATION);
     setApplicationName(PROJECT_NAME);
     setApplicationVersion(PROJECT_VERSION);
-    setWindowIcon(QIcon(":/images/arduide.png"));
+    if (mGui)
+        setWindowIcon(QIcon(":/images/arduide.png"));
 
     // translation support
     initializeTranslator();
@@ -62,6 +74,13 @@ IDEApplication::IDEApplication(int& argc, char **argv)
 
     registerMetaTypes();
 
+    // command line builds only need the settings and the libraries
+    if (! mGui)
+    {
+        initializeSettings();
+        return;
+    }
+
     // initialize Grantlee
     initializeTemplates();
 
@@ -98,7 +117,8 @@ void IDEApplication::initializeSettings()
 {
     mSettings = new Settings;
 
-    if (! mSettings->isCorrect())
+    // without the GUI, the command line reports the problem itself
+    if (mGui && ! mSettings->isCorrect())
     {
         FirstTimeWizard w;
         if (w.exec() == QWizard::Rejected)
@@ -106,6 +126,10 @@ void IDEApplication::initializeSettings()
     }
 
     mProjectHistory = new ProjectHistory(this);
+
+    // index the installed libraries once, the index follows the changes
+    mLibraryIndex = new LibraryIndex(this);
+    mLibraryIndex->update();
 }
 
 void IDEApplication::initializePlugins()
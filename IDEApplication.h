@@ -39,6 +39,7 @@
 #include "gui/MainWindow.h"
 #include "gui/FirstTimeWizard.h"
 #include "env/ProjectHistory.h"
+#include "env/LibraryIndex.h"
 #include "env/Settings.h"
 #include "IDEGlobal.h"
 
@@ -49,11 +50,19 @@ class IDE_EXPORT IDEApplication : public QApplication
 public:
     IDEApplication(int& argc, char **argv);
 
+    /**
+     * @brief Return False when running from the command line, without windows
+     *
+     * @return bool
+     */
+    bool gui() const { return mGui; }
+
     const QString &dataPath() { return mDataPath; }
     MainWindow *mainWindow() { return mMainWindow; }
     Grantlee::Engine *engine() { return mEngine; }
     ProjectHistory *projectHistory() { return mProjectHistory; }
     Settings *settings() { return mSettings; }
+    LibraryIndex *libraryIndex() { return mLibraryIndex; }
 
 private:
     void registerMetaTypes();
@@ -63,12 +72,14 @@ private:
     void initializePlugins();
     void initializeTranslator();
 
+    bool mGui;
     QString mDataPath;
     MainWindow *mMainWindow;
     Grantlee::Engine *mEngine;
     QPluginLoader *mPluginLoader;
     ProjectHistory *mProjectHistory;
     Settings *mSettings;
+    LibraryIndex *mLibraryIndex;
     QTranslator mTranslator;
 };
 
@@ -0,0 +1,201 @@
+/*
+  BatchBuilder.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file BatchBuilder.cpp
+ * \author Denis Martinez
+ */
+
+#include "BatchBuilder.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QEventLoop>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QMetaObject>
+
+#include "IDEApplication.h"
+
+#include "Builder.h"
+#include "Toolkit.h"
+
+/**
+ * @brief Build of a single sketch of the batch, run on the sketch pool
+ *
+ */
+class SketchBuild : public QRunnable
+{
+public:
+    SketchBuild(BatchBuilder *batch, int index, Builder *builder, const QString &code)
+        : batch(batch),
+          index(index),
+          builder(builder),
+          code(code)
+    {
+    }
+
+    void run()
+    {
+        bool success = builder->build(code);
+        QMetaObject::invokeMethod(batch, "finishSketch", Qt::QueuedConnection, Q_ARG(int, index), Q_ARG(bool, success));
+    }
+
+private:
+    BatchBuilder *batch;
+    int index;
+    Builder *builder;
+    QString code;
+};
+
+BatchBuilder::BatchBuilder(QObject *parent)
+    : QObject(parent),
+      mJobTokens(Builder::jobCount()),
+      mRunning(0),
+      mFailures(0),
+      mLoop(NULL)
+{
+}
+
+BatchBuilder::~BatchBuilder()
+{
+    // the builders use the caches until they are deleted
+    qDeleteAll(mBuilders);
+    qDeleteAll(mCaches);
+}
+
+bool BatchBuilder::addSketch(const QString &fileName)
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::ReadOnly))
+        return false;
+
+    Builder *builder = new Builder(this);
+    builder->setJobTokens(&mJobTokens);
+    builder->setSketchFile(fileName);
+    if (! mBoard.isNull())
+        builder->setBoard(mBoard);
+
+    // read the profile of the sketch now, the builds don't touch the settings
+    builder->setProfile(mProfile.isNull() ? builder->profile() : mProfile);
+    builder->setCache(cache(builder->profile()));
+
+    mSketches << fileName;
+    mCodes << QString::fromLocal8Bit(file.readAll());
+    mBuilders << builder;
+    return true;
+}
+
+QStringList BatchBuilder::sketchbookFiles(const QString &directory)
+{
+    QStringList files;
+    QDir dir(directory);
+    foreach (const QString &sketch, Toolkit::findSketchesInDirectory(directory))
+    {
+        QString fileName = dir.filePath(QString("%0/%0.ino").arg(sketch));
+        if (! QFileInfo(fileName).exists())
+            fileName = dir.filePath(QString("%0/%0.pde").arg(sketch));
+        files << fileName;
+    }
+    return files;
+}
+
+void BatchBuilder::setBoard(const QString &board)
+{
+    mBoard = board;
+    foreach (Builder *builder, mBuilders)
+        builder->setBoard(board);
+}
+
+void BatchBuilder::setProfile(const QString &profile)
+{
+    mProfile = profile;
+    foreach (Builder *builder, mBuilders)
+    {
+        builder->setProfile(profile);
+        builder->setCache(cache(profile));
+    }
+}
+
+BuildCache *BatchBuilder::cache(const QString &profile)
+{
+    BuildCache *&cache = mCaches[profile];
+    if (cache == NULL)
+        cache = new BuildCache(Builder::cachePath(profile));
+    return cache;
+}
+
+int BatchBuilder::build()
+{
+    if (mBuilders.isEmpty())
+        return 0;
+
+    // read the boards and the libraries once, before the threads share them
+    mBuilders.first()->board();
+    ideApp->libraryIndex()->update();
+
+    // the sketches mostly wait for their compilers, the job tokens are what
+    // limits the parallelism
+    QThreadPool pool;
+    pool.setMaxThreadCount(Builder::jobCount());
+
+    QEventLoop loop;
+    mLoop = &loop;
+    mRunning = mBuilders.size();
+    mFailures = 0;
+    for (int i = 0; i < mBuilders.size(); i++)
+    {
+        mBuilders.at(i)->setTraceFileName(traceFileName(i));
+        pool.start(new SketchBuild(this, i, mBuilders.at(i), mCodes.at(i)));
+    }
+    loop.exec();
+    mLoop = NULL;
+
+    pool.waitForDone();
+    return mFailures;
+}
+
+QString BatchBuilder::traceFileName(int index) const
+{
+    QString fileName = mTraceFileName;
+    if (fileName.isEmpty() && ideApp->settings()->buildTiming())
+        fileName = QDir(BuildCache::defaultPath()).filePath("trace.json");
+    if (fileName.isEmpty())
+        return QString();
+
+    // trace.json becomes trace-Blink.json
+    QFileInfo info(fileName);
+    QString suffix = info.suffix().isEmpty() ? QString() : "." + info.suffix();
+    return info.dir().filePath(QString("%0-%1%2").arg(info.completeBaseName(), QFileInfo(mSketches.at(index)).completeBaseName(), suffix));
+}
+
+void BatchBuilder::finishSketch(int index, bool success)
+{
+    if (! success)
+        mFailures++;
+    emit sketchFinished(index, success);
+
+    if (--mRunning == 0 && mLoop != NULL)
+        mLoop->quit();
+}
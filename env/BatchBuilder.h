@@ -0,0 +1,171 @@
+/*
+  BatchBuilder.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file BatchBuilder.h
+ * \author Denis Martinez
+ */
+
+#ifndef BATCHBUILDER_H
+#define BATCHBUILDER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QSemaphore>
+
+#include "BuildCache.h"
+
+class QEventLoop;
+class Builder;
+
+/**
+ * @brief Build many sketches at once
+ *
+ * The sketches are built in parallel by builders sharing the same build
+ * cache, so the core and the libraries they have in common are compiled
+ * once, and the same job tokens, so the number of compilers running at the
+ * same time stays below Builder::jobCount().
+ */
+class BatchBuilder : public QObject
+{
+    Q_OBJECT
+
+public:
+    BatchBuilder(QObject *parent = NULL);
+    ~BatchBuilder();
+
+    /**
+     * @brief Add a sketch to build
+     *
+     * @param fileName Sketch file
+     * @return bool, False if the sketch can't be read
+     */
+    bool addSketch(const QString &fileName);
+
+    /**
+     * @brief Return the sketch files found in a sketchbook
+     *
+     * @param directory Sketchbook, holding a directory per sketch
+     * @return QStringList
+     */
+    static QStringList sketchbookFiles(const QString &directory);
+
+    /**
+     * @brief Build for another board than the one selected in the settings
+     *
+     * @param board Board, see Builder::setBoard()
+     * @return void
+     */
+    void setBoard(const QString &board);
+
+    /**
+     * @brief Build every sketch with the same profile, instead of their own ones
+     *
+     * @param profile Build profile, see Builder::setProfile()
+     * @return void
+     */
+    void setProfile(const QString &profile);
+
+    /**
+     * @brief Save the trace of each build
+     *
+     * The name of the sketch is appended to the base name of the file.
+     *
+     * @param fileName Trace file
+     * @return void
+     */
+    void setTraceFileName(const QString &fileName) { mTraceFileName = fileName; }
+
+    /**
+     * @brief Return the sketches added
+     *
+     * @return const QStringList&
+     */
+    const QStringList &sketches() const { return mSketches; }
+
+    /**
+     * @brief Return the builder of a sketch
+     *
+     * Its signals are emitted from the thread building the sketch.
+     *
+     * @param index Index of the sketch
+     * @return Builder*
+     */
+    Builder *builder(int index) const { return mBuilders.at(index); }
+
+    /**
+     * @brief Build all the sketches
+     *
+     * The events are processed until the last build finishes.
+     *
+     * @return int, the number of sketches which failed to build
+     */
+    int build();
+
+signals:
+    void sketchFinished(int index, bool success);
+
+private:
+    /**
+     * @brief Return the trace file of a sketch
+     *
+     * @param index Index of the sketch
+     * @return QString, empty if no trace is saved
+     */
+    QString traceFileName(int index) const;
+
+    /**
+     * @brief Return the cache shared by the sketches built with a profile
+     *
+     * @param profile Build profile
+     * @return BuildCache*
+     */
+    BuildCache *cache(const QString &profile);
+
+    QHash<QString, BuildCache *> mCaches;
+    QSemaphore mJobTokens;
+    QStringList mSketches;
+    QStringList mCodes;
+    QList<Builder *> mBuilders;
+    QString mBoard;
+    QString mProfile;
+    QString mTraceFileName;
+    int mRunning;
+    int mFailures;
+    QEventLoop *mLoop;
+
+private slots:
+    /**
+     * @brief Called in the main thread when a build finished
+     *
+     * @param index Index of the sketch
+     * @param success True if the sketch was built
+     * @return void
+     */
+    void finishSketch(int index, bool success);
+};
+
+#endif // BATCHBUILDER_H
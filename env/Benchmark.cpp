@@ -0,0 +1,195 @@
+/*
+  Benchmark.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file Benchmark.cpp
+ * \author Denis Martinez
+ */
+
+#include "Benchmark.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QScopedPointer>
+#include <qxttemporarydir.h>
+
+#include "IDEApplication.h"
+
+#include "Builder.h"
+#include "BuildCache.h"
+#include "StubToolchain.h"
+#include "Toolkit.h"
+#include "utils/Json.h"
+
+Benchmark::Benchmark(QObject *parent)
+    : QObject(parent),
+      mStubToolchain(false)
+{
+}
+
+QStringList Benchmark::exampleFiles()
+{
+    QStringList files;
+    foreach (const QString &category, Toolkit::findExampleCategories())
+    {
+        foreach (const QString &example, Toolkit::findExamples(category))
+            files << Toolkit::exampleFileName(category, example);
+    }
+    foreach (const QString &library, Toolkit::librariesWithExamples())
+    {
+        foreach (const QString &example, Toolkit::findLibraryExamples(library))
+            files << Toolkit::libraryExampleFileName(library, example);
+    }
+    files.removeAll(QString());
+    return files;
+}
+
+bool Benchmark::run(const QString &outputDirectory)
+{
+    static const char *scenarios[] = { "cold", "warm", "edit" };
+
+    mResults.clear();
+    QDir output(outputDirectory);
+    if (! QDir().mkpath(output.path()))
+        return false;
+
+    QScopedPointer<QxtTemporaryDir> stubDir;
+    if (mStubToolchain)
+    {
+        stubDir.reset(new QxtTemporaryDir(QDir(QDir::tempPath()).filePath("arduide-stub")));
+        if (! StubToolchain::install(stubDir->path()))
+            return false;
+        Toolkit::setAvrPath(stubDir->path());
+    }
+
+    QStringList sketches = exampleFiles();
+    // the results don't depend on the profiles stored for the examples
+    Builder builder;
+    builder.setProfile(Toolkit::defaultBuildProfile());
+    foreach (const QString &board, mBoards)
+    {
+        builder.setBoard(board);
+        foreach (const QString &sketch, sketches)
+        {
+            QFile file(sketch);
+            if (! file.open(QIODevice::ReadOnly))
+                continue;
+            QString code = QString::fromLocal8Bit(file.readAll());
+            builder.setSketchFile(sketch);
+
+            // a cache of its own for each sketch, so the cold build is cold
+            BuildCache cache(output.filePath("cache"));
+            cache.clear();
+            builder.setCache(&cache);
+
+            for (int i = 0; i < 3; i++)
+            {
+                if (i == 2)
+                    code += "\n// edited by the benchmark\n";
+
+                Result result;
+                result.board = board;
+                result.sketch = QDir(ideApp->settings()->arduinoPath()).relativeFilePath(sketch);
+                result.scenario = scenarios[i];
+                result.success = builder.build(code);
+                result.msecs = 0;
+                foreach (const BuildTrace::Event &event, builder.trace().events())
+                {
+                    if (event.category != "phase")
+                        continue;
+                    result.phases << qMakePair(event.name, event.duration / 1000);
+                    result.msecs = qMax(result.msecs, event.duration / 1000);
+                }
+                mResults << result;
+                emit sketchBuilt(result.board, result.sketch, result.scenario, result.success, result.msecs);
+            }
+            builder.setCache(NULL);
+        }
+    }
+
+    if (mStubToolchain)
+        Toolkit::setAvrPath(QString());
+
+    return writeJson(output.filePath("benchmark.json")) && writeCsv(output.filePath("benchmark.csv"));
+}
+
+bool Benchmark::writeJson(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::WriteOnly))
+        return false;
+
+    QByteArray json = "{\n";
+    json += "\"version\":" + Json::quote(PROJECT_VERSION) + ",\n";
+    json += "\"date\":" + Json::quote(QDateTime::currentDateTime().toString(Qt::ISODate)) + ",\n";
+    json += "\"toolchain\":" + Json::quote(mStubToolchain ? "stub" : "avr") + ",\n";
+    json += "\"jobs\":" + QByteArray::number(Builder::jobCount()) + ",\n";
+    json += "\"results\":[";
+    for (int i = 0; i < mResults.size(); i++)
+    {
+        const Result &result = mResults.at(i);
+        json += i > 0 ? ",\n" : "\n";
+        json += "{\"board\":" + Json::quote(result.board)
+            + ",\"sketch\":" + Json::quote(result.sketch)
+            + ",\"scenario\":" + Json::quote(result.scenario)
+            + ",\"success\":" + (result.success ? "true" : "false")
+            + ",\"msecs\":" + QByteArray::number(result.msecs)
+            + ",\"phases\":{";
+        for (int j = 0; j < result.phases.size(); j++)
+        {
+            if (j > 0)
+                json += ',';
+            json += Json::quote(result.phases.at(j).first) + ':' + QByteArray::number(result.phases.at(j).second);
+        }
+        json += "}}";
+    }
+    json += "\n]\n}\n";
+    return file.write(json) == json.size();
+}
+
+bool Benchmark::writeCsv(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::WriteOnly))
+        return false;
+
+    QByteArray csv = "board,sketch,scenario,success,phase,msecs\n";
+    foreach (const Result &result, mResults)
+    {
+        // the fields are quoted, sketch paths may contain commas
+        QStringList fields;
+        fields << result.board << result.sketch << result.scenario << (result.success ? "1" : "0");
+        QByteArray prefix;
+        foreach (QString field, fields)
+            prefix += '"' + field.replace('"', "\"\"").toUtf8() + "\",";
+
+        for (int i = 0; i < result.phases.size(); i++)
+        {
+            QString phase = result.phases.at(i).first;
+            csv += prefix + '"' + phase.replace('"', "\"\"").toUtf8() + "\"," + QByteArray::number(result.phases.at(i).second) + '\n';
+        }
+    }
+    return file.write(csv) == csv.size();
+}
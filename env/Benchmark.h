@@ -0,0 +1,132 @@
+/*
+  Benchmark.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file Benchmark.h
+ * \author Denis Martinez
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+
+/**
+ * @brief Measure the build times of the bundled examples
+ *
+ * Each example is built three times per board: with an empty build cache
+ * (cold), again without any change (warm), then after a one-line edit of
+ * the sketch (edit). The timings of each phase are written in
+ * benchmark.json and benchmark.csv, to compare them across commits.
+ */
+class Benchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Timings of one build
+     *
+     */
+    struct Result
+    {
+        QString board;
+        QString sketch;
+        QString scenario;
+        bool success;
+        qint64 msecs;
+        QList<QPair<QString, qint64> > phases;
+    };
+
+    Benchmark(QObject *parent = NULL);
+
+    /**
+     * @brief Set the boards the examples are built for
+     *
+     * @param boards Boards, as given to Builder::setBoard()
+     * @return void
+     */
+    void setBoards(const QStringList &boards) { mBoards = boards; }
+
+    /**
+     * @brief Build with the stub toolchain, see StubToolchain
+     *
+     * Only the time spent in the IDE is then measured.
+     *
+     * @param stub True to use the stub toolchain
+     * @return void
+     */
+    void setStubToolchain(bool stub) { mStubToolchain = stub; }
+
+    /**
+     * @brief Return the examples of the SDK and of the libraries
+     *
+     * @return QStringList, sketch files
+     */
+    static QStringList exampleFiles();
+
+    /**
+     * @brief Build the examples and write the results
+     *
+     * @param outputDirectory Directory of the results and of the build cache
+     * @return bool, False if the results can't be written
+     */
+    bool run(const QString &outputDirectory);
+
+    /**
+     * @brief Return the results of the last run
+     *
+     * @return const QList<Benchmark::Result>&
+     */
+    const QList<Result> &results() const { return mResults; }
+
+signals:
+    void sketchBuilt(const QString &board, const QString &sketch, const QString &scenario, bool success, qint64 msecs);
+
+private:
+    /**
+     * @brief Write the results in JSON
+     *
+     * @param fileName File name
+     * @return bool, True if success or False if not
+     */
+    bool writeJson(const QString &fileName) const;
+
+    /**
+     * @brief Write the results in CSV, one line per phase
+     *
+     * @param fileName File name
+     * @return bool, True if success or False if not
+     */
+    bool writeCsv(const QString &fileName) const;
+
+    QStringList mBoards;
+    bool mStubToolchain;
+    QList<Result> mResults;
+};
+
+#endif // BENCHMARK_H
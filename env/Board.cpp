@@ -30,11 +30,14 @@ This program is free software; you can redistribute it and/or modify
 #include <QFile>
 #include <QDir>
 #include <QDebug>
+#include <QMutexLocker>
 
 #include "Toolkit.h"
 
 QMap<QString, Board> Board::mBoards;
 bool Board::mListed = false;
+QMutex Board::mMutex;
+QHash<QString, const Board *> Board::mSelections;
 
 const QString& Board::name() const
 {
@@ -111,12 +114,14 @@ void Board::listBoards()
 
 QStringList Board::boardIds()
 {
+    QMutexLocker locker(&mMutex);
     listBoards();
     return mBoards.keys();
 }
 
 const Board *Board::boardInfo(const QString &name)
 {
+    QMutexLocker locker(&mMutex);
     listBoards();
     const Board *board = NULL;
     QMap<QString, Board>::const_iterator it = mBoards.constFind(name);
@@ -125,6 +130,26 @@ const Board *Board::boardInfo(const QString &name)
     return board;
 }
 
+const Board *Board::selectedBoard(const QString &name, const QString &mcu, const QString &freq)
+{
+    QMutexLocker locker(&mMutex);
+    listBoards();
+
+    QString key = QString("%0,%1,%2").arg(name, mcu, freq);
+    QHash<QString, const Board *>::const_iterator it = mSelections.constFind(key);
+    if (it != mSelections.constEnd())
+        return *it;
+
+    QMap<QString, Board>::const_iterator board = mBoards.constFind(name);
+    if (board == mBoards.constEnd())
+        return NULL;
+
+    Board *selection = new Board(*board);
+    selection->setSelectedBoard(name, mcu, freq);
+    mSelections.insert(key, selection);
+    return selection;
+}
+
 QString Board::attribute(const QString &attr) const
 {
     QHash<QString, QString>::const_iterator it = mAttributes.constFind(attr);
@@ -33,6 +33,7 @@ This program is free software; you can redistribute it and/or modify
 #include <QStringList>
 #include <QHash>
 #include <QMap>
+#include <QMutex>
 
 /**
  * @brief A class to help deal with boards.txt
@@ -68,6 +69,19 @@ public:
      */
     static const Board *boardInfo(const QString &name);
 
+    /**
+     * @brief Return a board with a selected mcu and frequency
+     *
+     * A copy of the board is made for each selection and is never modified
+     * nor freed, so that the builds running in parallel can share it.
+     *
+     * @param name The board name. e.g: "uno" (uno.name=Arduino Uno)
+     * @param mcu Selected mcu
+     * @param freq Selected frequency
+     * @return const Board*, NULL if the board is unknown
+     */
+    static const Board *selectedBoard(const QString &name, const QString &mcu, const QString &freq);
+
     /**
      * @brief Return the path of hardware directory
      *
@@ -137,6 +151,8 @@ private:
     /**
     * @brief Function that read boards.txt to identify all compatible boards
     *
+    * Must be called with mMutex locked.
+    *
     * @return void
     */
     static void listBoards();
@@ -148,6 +164,18 @@ private:
      */
     static bool mListed;
 
+    /**
+     * @brief Protects the listing of the boards and the selections
+     *
+     */
+    static QMutex mMutex;
+
+    /**
+     * @brief Boards returned by selectedBoard(), by name, mcu and frequency
+     *
+     */
+    static QHash<QString, const Board *> mSelections;
+
     QString mHardwarePath;
 };
 
@@ -0,0 +1,361 @@
+/*
+  BuildCache.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file BuildCache.cpp
+ * \author Denis Martinez
+ */
+
+#include "BuildCache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QProcess>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDesktopServices>
+#include <QDebug>
+
+#include "utils/FileUtils.h"
+
+#if defined(Q_OS_WIN32) || defined(Q_OS_WIN64)
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+// the entries not used for this long are removed once a day
+static const int pruneInterval = 24 * 3600;
+
+BuildCache::BuildCache()
+    : mPath(defaultPath()),
+      mDependencies(QDir(mPath).filePath("dependencies"))
+{
+}
+
+BuildCache::BuildCache(const QString &path)
+    : mPath(path),
+      mDependencies(QDir(mPath).filePath("dependencies"))
+{
+}
+
+QString BuildCache::defaultPath(const QString &space)
+{
+    QDir root(QDir(QDesktopServices::storageLocation(QDesktopServices::CacheLocation)).filePath("build"));
+    if (space.isEmpty())
+        return root.path();
+    return root.filePath(QString("namespaces/%0").arg(space));
+}
+
+QByteArray BuildCache::key(const QString &compiler, const QStringList &arguments, const QString &source)
+{
+    QFile file(source);
+    if (! file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QByteArray version = toolchainVersion(compiler);
+    if (version.isEmpty())
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QFileInfo(compiler).fileName().toUtf8());
+    hash.addData(version);
+    hash.addData(arguments.join("\n").toUtf8());
+    // the extension decides how the compiler handles the file
+    hash.addData(QFileInfo(source).suffix().toUtf8());
+    hash.addData(file.readAll());
+    return hash.result().toHex();
+}
+
+QByteArray BuildCache::objectKey(const QByteArray &unitKey)
+{
+    if (unitKey.isEmpty())
+        return QByteArray();
+
+    QMutexLocker locker(&mMutex);
+    QByteArray dependencies = mDependencies.dependencyDigest(unitKey);
+    if (dependencies.isEmpty())
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(unitKey);
+    hash.addData(dependencies);
+    return hash.result().toHex();
+}
+
+bool BuildCache::recordDependencies(const QByteArray &unitKey, const QString &depFileName)
+{
+    if (unitKey.isEmpty())
+        return false;
+
+    QMutexLocker locker(&mMutex);
+    return mDependencies.record(unitKey, depFileName);
+}
+
+bool BuildCache::save()
+{
+    bool success;
+    {
+        QMutexLocker locker(&mMutex);
+        success = mDependencies.save();
+    }
+    prune();
+    return success;
+}
+
+QString BuildCache::objectPath(const QByteArray &key) const
+{
+    static const QString format("objects/%0/%1.o");
+    QString hex = QString::fromLatin1(key);
+    return QDir(mPath).filePath(format.arg(hex.left(2), hex));
+}
+
+bool BuildCache::contains(const QByteArray &key) const
+{
+    return ! key.isEmpty() && touch(objectPath(key));
+}
+
+bool BuildCache::store(const QByteArray &key, const QString &objectFileName)
+{
+    if (key.isEmpty())
+        return false;
+
+    return copyInto(objectFileName, objectPath(key));
+}
+
+QString BuildCache::coreArchivePath(const QByteArray &key) const
+{
+    static const QString format("cores/%0/core.a");
+    return QDir(mPath).filePath(format.arg(QString::fromLatin1(key)));
+}
+
+QByteArray BuildCache::coreManifest(const QStringList &directories)
+{
+    QByteArray manifest;
+    foreach (const QString &directory, directories)
+    {
+        if (directory.isEmpty())
+            continue;
+
+        QDir dir(directory);
+        foreach (const QFileInfo &info, dir.entryInfoList(QDir::Files, QDir::Name))
+        {
+            manifest += info.absoluteFilePath().toUtf8();
+            manifest += ' ';
+            manifest += QByteArray::number(info.size());
+            manifest += ' ';
+            manifest += QByteArray::number(info.lastModified().toTime_t());
+            manifest += '\n';
+        }
+    }
+    return manifest;
+}
+
+bool BuildCache::containsCoreArchive(const QByteArray &key, const QByteArray &manifest) const
+{
+    QString archive = coreArchivePath(key);
+    if (key.isEmpty() || ! touch(archive))
+        return false;
+
+    QFile file(archive + ".manifest");
+    if (! file.open(QIODevice::ReadOnly))
+        return false;
+    return file.readAll() == manifest;
+}
+
+bool BuildCache::storeCoreArchive(const QByteArray &key, const QByteArray &manifest, const QString &archiveFileName)
+{
+    if (key.isEmpty())
+        return false;
+
+    // the old manifest goes first and the new one comes last, so that a
+    // parallel build never pairs an archive with the manifest of another
+    QString archive = coreArchivePath(key);
+    QFile::remove(archive + ".manifest");
+    return copyInto(archiveFileName, archive) && writeInto(manifest, archive + ".manifest");
+}
+
+bool BuildCache::claimUnit(const QByteArray &unitKey)
+{
+    QMutexLocker locker(&mMutex);
+    if (mPendingUnits.contains(unitKey))
+        return false;
+
+    mPendingUnits.insert(unitKey);
+    return true;
+}
+
+void BuildCache::releaseUnit(const QByteArray &unitKey, const QString &objectPath)
+{
+    QMutexLocker locker(&mMutex);
+    mPendingUnits.remove(unitKey);
+    mReleasedUnits.insert(unitKey, objectPath);
+    mUnitReleased.wakeAll();
+}
+
+QString BuildCache::waitForUnit(const QByteArray &unitKey)
+{
+    QMutexLocker locker(&mMutex);
+    while (mPendingUnits.contains(unitKey))
+        mUnitReleased.wait(&mMutex);
+    return mReleasedUnits.value(unitKey);
+}
+
+QString BuildCache::temporaryName(const QString &destination)
+{
+    // the builds of a process run in parallel, and the IDE shares the cache
+    // with the command line builds
+    return destination + QString(".%0.%1.tmp")
+        .arg(QCoreApplication::applicationPid())
+        .arg(quintptr(QThread::currentThreadId()));
+}
+
+bool BuildCache::copyInto(const QString &fileName, const QString &destination)
+{
+    if (! QDir().mkpath(QFileInfo(destination).path()))
+        return false;
+
+    // copy under a temporary name first, so that an interrupted copy never
+    // leaves a truncated file behind
+    QString temporary = temporaryName(destination);
+    QFile::remove(temporary);
+    if (! QFile::copy(fileName, temporary))
+        return false;
+    QFile::remove(destination);
+    return QFile::rename(temporary, destination);
+}
+
+bool BuildCache::writeInto(const QByteArray &data, const QString &destination)
+{
+    if (! QDir().mkpath(QFileInfo(destination).path()))
+        return false;
+
+    QString temporary = temporaryName(destination);
+    QFile file(temporary);
+    if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    bool written = file.write(data) == data.size();
+    file.close();
+    if (! written || file.error() != QFile::NoError)
+    {
+        QFile::remove(temporary);
+        return false;
+    }
+    QFile::remove(destination);
+    return QFile::rename(temporary, destination);
+}
+
+bool BuildCache::touch(const QString &fileName)
+{
+    QFileInfo info(fileName);
+    if (! info.isFile())
+        return false;
+
+    // only refresh the time once a day, like the units of the dependency graph
+    if (info.lastModified().secsTo(QDateTime::currentDateTime()) > pruneInterval)
+    {
+#if defined(Q_OS_WIN32) || defined(Q_OS_WIN64)
+        _wutime(reinterpret_cast<const wchar_t *>(fileName.utf16()), NULL);
+#else
+        utime(QFile::encodeName(fileName).constData(), NULL);
+#endif
+    }
+    return true;
+}
+
+void BuildCache::prune()
+{
+    QDir root(mPath);
+    QString stampFileName = root.filePath("pruned");
+    QDateTime now = QDateTime::currentDateTime();
+    QFileInfo stamp(stampFileName);
+    if (stamp.exists() && stamp.lastModified().secsTo(now) < pruneInterval)
+        return;
+
+    QFile file(stampFileName);
+    if (! QDir().mkpath(mPath) || ! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return;
+    file.write(now.toString(Qt::ISODate).toLatin1());
+    file.close();
+
+    // the entries are refreshed when used, see touch(), so the objects left
+    // are the ones of units the dependency graph forgot
+    QDateTime limit = now.addSecs(-int(DependencyGraph::unitLifetime()));
+    QDir objects(root.filePath("objects"));
+    foreach (const QFileInfo &directory, objects.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        QDir dir(directory.filePath());
+        foreach (const QFileInfo &info, dir.entryInfoList(QDir::Files))
+        {
+            if (info.lastModified() < limit)
+                QFile::remove(info.filePath());
+        }
+        // only removed once empty
+        objects.rmdir(directory.fileName());
+    }
+
+    QDir cores(root.filePath("cores"));
+    foreach (const QFileInfo &directory, cores.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        QFileInfo archive(QDir(directory.filePath()).filePath("core.a"));
+        if (archive.isFile() && archive.lastModified() < limit)
+            FileUtils::recursiveRemove(directory.filePath());
+    }
+}
+
+bool BuildCache::clear()
+{
+    if (! QFileInfo(mPath).isDir())
+        return true;
+    return FileUtils::recursiveRemove(mPath, true);
+}
+
+void BuildCache::reset()
+{
+    QMutexLocker locker(&mMutex);
+    mDependencies.beginBuild();
+}
+
+QByteArray BuildCache::toolchainVersion(const QString &compiler)
+{
+    static QMutex mutex;
+    static QHash<QString, QByteArray> versions;
+
+    QMutexLocker locker(&mutex);
+    QHash<QString, QByteArray>::const_iterator it = versions.constFind(compiler);
+    if (it != versions.constEnd())
+        return *it;
+
+    QByteArray version;
+    QProcess proc;
+    proc.start(compiler, QStringList() << "-dumpversion");
+    if (proc.waitForFinished() && proc.exitCode() == 0)
+        version = proc.readAllStandardOutput().trimmed();
+    versions.insert(compiler, version);
+    return version;
+}
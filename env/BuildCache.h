@@ -0,0 +1,297 @@
+/*
+  BuildCache.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file BuildCache.h
+ * \author Denis Martinez
+ */
+
+#ifndef BUILDCACHE_H
+#define BUILDCACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "DependencyGraph.h"
+
+/**
+ * @brief Persistent store of compiled objects, shared between builds
+ *
+ * Objects are addressed by a hash of everything that influences the output
+ * of the compiler: the contents of the source, the compiler version, the
+ * compiler flags (which carry the board, mcu and frequency) and the headers
+ * the source included the last time it was compiled.
+ *
+ * A cache may be shared by builders running in parallel: a translation unit
+ * needed by several of them is then only compiled once, see claimUnit().
+ */
+class BuildCache
+{
+public:
+    /**
+     * @brief Open the cache located in the default cache directory
+     *
+     */
+    BuildCache();
+
+    /**
+     * @brief Open the cache located in a specific directory
+     *
+     * @param path Cache directory
+     */
+    explicit BuildCache(const QString &path);
+
+    /**
+     * @brief Return the default location of the cache
+     *
+     * Builds which should not share their entries with the others use a
+     * namespace, a directory of its own in the cache.
+     *
+     * @param space Namespace, or empty for the main cache
+     * @return QString
+     */
+    static QString defaultPath(const QString &space = QString());
+
+    /**
+     * @brief Return the location of the cache
+     *
+     * @return QString
+     */
+    QString path() const { return mPath; }
+
+    /**
+     * @brief Compute the key of a translation unit
+     *
+     * The key covers the source, the compiler and its arguments, but not the
+     * headers, see objectKey().
+     *
+     * @param compiler Compiler used to build the source
+     * @param arguments Compiler arguments, without the input and output files
+     * @param source Source file
+     * @return QByteArray, an empty key if the unit can't be cached
+     */
+    QByteArray key(const QString &compiler, const QStringList &arguments, const QString &source);
+
+    /**
+     * @brief Compute the key of the object of a translation unit
+     *
+     * @param unitKey Key of the translation unit
+     * @return QByteArray, an empty key if the headers of the unit are unknown
+     */
+    QByteArray objectKey(const QByteArray &unitKey);
+
+    /**
+     * @brief Remember the headers included by a translation unit
+     *
+     * @param unitKey Key of the translation unit
+     * @param depFileName .d file written by the compiler
+     * @return bool, True if success or False if not
+     */
+    bool recordDependencies(const QByteArray &unitKey, const QString &depFileName);
+
+    /**
+     * @brief Save what was learnt about the headers during the build
+     *
+     * Once a day, the objects and core archives not used since the dependency
+     * graph forgot their units are also removed.
+     *
+     * @return bool, True if success or False if not
+     */
+    bool save();
+
+    /**
+     * @brief Return the location of the object stored under a key
+     *
+     * @param key Key of the translation unit
+     * @return QString
+     */
+    QString objectPath(const QByteArray &key) const;
+
+    /**
+     * @brief Check if an object is stored under a key
+     *
+     * @param key Key of the translation unit
+     * @return bool
+     */
+    bool contains(const QByteArray &key) const;
+
+    /**
+     * @brief Store a freshly compiled object
+     *
+     * @param key Key of the translation unit
+     * @param objectFileName Object to store
+     * @return bool, True if success or False if not
+     */
+    bool store(const QByteArray &key, const QString &objectFileName);
+
+    /**
+     * @brief Return the location of the prebuilt core archive of a board configuration
+     *
+     * @param key Key of the board configuration
+     * @return QString
+     */
+    QString coreArchivePath(const QByteArray &key) const;
+
+    /**
+     * @brief Describe the files a core archive is built from
+     *
+     * The manifest lists the name, size and modification time of the files
+     * found in the given directories.
+     *
+     * @param directories Core and variant directories
+     * @return QByteArray
+     */
+    static QByteArray coreManifest(const QStringList &directories);
+
+    /**
+     * @brief Check if an up to date core archive is stored
+     *
+     * @param key Key of the board configuration
+     * @param manifest Manifest of the core sources
+     * @return bool
+     */
+    bool containsCoreArchive(const QByteArray &key, const QByteArray &manifest) const;
+
+    /**
+     * @brief Store a core archive with the manifest of its sources
+     *
+     * @param key Key of the board configuration
+     * @param manifest Manifest of the core sources
+     * @param archiveFileName Archive to store
+     * @return bool, True if success or False if not
+     */
+    bool storeCoreArchive(const QByteArray &key, const QByteArray &manifest, const QString &archiveFileName);
+
+    /**
+     * @brief Claim the compilation of a translation unit
+     *
+     * @param unitKey Key of the translation unit
+     * @return bool, True if the caller must compile the unit then call
+     * releaseUnit(), or False if another build is already compiling it
+     */
+    bool claimUnit(const QByteArray &unitKey);
+
+    /**
+     * @brief Publish the result of the compilation of a claimed unit
+     *
+     * @param unitKey Key of the translation unit
+     * @param objectPath Object stored in the cache, empty if the compilation failed
+     * @return void
+     */
+    void releaseUnit(const QByteArray &unitKey, const QString &objectPath);
+
+    /**
+     * @brief Wait until another build compiled a translation unit
+     *
+     * @param unitKey Key of the translation unit
+     * @return QString, the object stored in the cache, or empty if the compilation failed
+     */
+    QString waitForUnit(const QByteArray &unitKey);
+
+    /**
+     * @brief Remove every object from the cache
+     *
+     * @return bool, True if success or False if not
+     */
+    bool clear();
+
+    /**
+     * @brief Forget which headers were checked during the previous build
+     *
+     * Must be called before each build so header modifications are seen.
+     *
+     * @return void
+     */
+    void reset();
+
+    /**
+     * @brief Return the version of a compiler
+     *
+     * The compiler is only queried once per session.
+     *
+     * @param compiler Compiler
+     * @return QByteArray
+     */
+    static QByteArray toolchainVersion(const QString &compiler);
+
+private:
+    /**
+     * @brief Copy a file into the cache, replacing any previous version atomically
+     *
+     * @param fileName File to copy
+     * @param destination Location in the cache
+     * @return bool, True if success or False if not
+     */
+    static bool copyInto(const QString &fileName, const QString &destination);
+
+    /**
+     * @brief Return a temporary name for a file of the cache, unique to the calling thread
+     *
+     * @param destination Location in the cache
+     * @return QString
+     */
+    static QString temporaryName(const QString &destination);
+
+    /**
+     * @brief Write a file of the cache, replacing any previous version atomically
+     *
+     * @param data Contents of the file
+     * @param destination Location in the cache
+     * @return bool, True if success or False if not
+     */
+    static bool writeInto(const QByteArray &data, const QString &destination);
+
+    /**
+     * @brief Mark an entry of the cache as used
+     *
+     * @param fileName Object or archive in the cache
+     * @return bool, True if the entry exists or False if not
+     */
+    static bool touch(const QString &fileName);
+
+    /**
+     * @brief Remove the entries not used for longer than the units of the dependency graph
+     *
+     * @return void
+     */
+    void prune();
+
+    QString mPath;
+    DependencyGraph mDependencies;
+
+    /**
+     * @brief Protects the dependencies and the units being compiled
+     *
+     */
+    QMutex mMutex;
+    QWaitCondition mUnitReleased;
+    QSet<QByteArray> mPendingUnits;
+    QHash<QByteArray, QString> mReleasedUnits;
+};
+
+#endif // BUILDCACHE_H
@@ -0,0 +1,122 @@
+/*
+  BuildTrace.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file BuildTrace.cpp
+ * \author Denis Martinez
+ */
+
+#include "BuildTrace.h"
+
+#include <QFile>
+#include <QThread>
+#include <QMutexLocker>
+
+#include "utils/Json.h"
+
+BuildTrace::BuildTrace()
+{
+    mTimer.start();
+}
+
+void BuildTrace::start()
+{
+    QMutexLocker locker(&mMutex);
+    mEvents.clear();
+    mThreads.clear();
+    // the thread running the build comes first
+    mThreads.insert(QThread::currentThread(), 0);
+    mTimer.restart();
+}
+
+qint64 BuildTrace::now() const
+{
+    return mTimer.nsecsElapsed() / 1000;
+}
+
+qint64 BuildTrace::addEvent(const QString &name, const QString &category, qint64 start)
+{
+    Event event;
+    event.name = name;
+    event.category = category;
+    event.start = start;
+    event.duration = now() - start;
+
+    QMutexLocker locker(&mMutex);
+    // threads are numbered in order of appearance
+    QThread *thread = QThread::currentThread();
+    QHash<QThread *, int>::const_iterator it = mThreads.constFind(thread);
+    if (it == mThreads.constEnd())
+        it = mThreads.insert(thread, mThreads.size());
+    event.thread = *it;
+    mEvents << event;
+    return event.duration;
+}
+
+QList<BuildTrace::Event> BuildTrace::events() const
+{
+    QMutexLocker locker(&mMutex);
+    return mEvents;
+}
+
+QByteArray BuildTrace::toChromeTrace() const
+{
+    QList<Event> events = this->events();
+    int threads = 0;
+    foreach (const Event &event, events)
+        threads = qMax(threads, event.thread + 1);
+
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (int i = 0; i < threads; i++)
+    {
+        QString name = i == 0 ? QString("builder") : QString("job %0").arg(i);
+        json += QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%0,\"args\":{\"name\":").arg(i).toUtf8();
+        json += Json::quote(name);
+        json += "}},\n";
+    }
+    for (int i = 0; i < events.size(); i++)
+    {
+        const Event &event = events.at(i);
+        json += "{\"name\":";
+        json += Json::quote(event.name);
+        json += ",\"cat\":";
+        json += Json::quote(event.category);
+        json += QString(",\"ph\":\"X\",\"ts\":%0,\"dur\":%1,\"pid\":1,\"tid\":%2}")
+            .arg(event.start).arg(event.duration).arg(event.thread).toUtf8();
+        if (i + 1 < events.size())
+            json += ',';
+        json += '\n';
+    }
+    json += "]}\n";
+    return json;
+}
+
+bool BuildTrace::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::WriteOnly))
+        return false;
+
+    QByteArray json = toChromeTrace();
+    return file.write(json) == json.size();
+}
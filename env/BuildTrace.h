@@ -0,0 +1,118 @@
+/*
+  BuildTrace.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file BuildTrace.h
+ * \author Denis Martinez
+ */
+
+#ifndef BUILDTRACE_H
+#define BUILDTRACE_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+
+class QThread;
+
+/**
+ * @brief Wall time spent in each phase, compilation and process of a build
+ *
+ * Events can be added from any thread. The trace can be saved in the Chrome
+ * trace event format, to be opened in chrome://tracing or Perfetto.
+ */
+class BuildTrace
+{
+public:
+    /**
+     * @brief Timed event, in microseconds since the start of the trace
+     *
+     */
+    struct Event
+    {
+        QString name;
+        QString category;
+        qint64 start;
+        qint64 duration;
+        int thread;
+    };
+
+    BuildTrace();
+
+    /**
+     * @brief Forget the previous events and start counting time
+     *
+     * Must be called from the thread running the build.
+     * @return void
+     */
+    void start();
+
+    /**
+     * @brief Return the time elapsed since start(), in microseconds
+     *
+     * @return qint64
+     */
+    qint64 now() const;
+
+    /**
+     * @brief Record an event of the calling thread
+     *
+     * @param name Event name
+     * @param category Event category, such as phase, compile or process
+     * @param start Start of the event, as returned by now()
+     * @return qint64, the duration of the event
+     */
+    qint64 addEvent(const QString &name, const QString &category, qint64 start);
+
+    /**
+     * @brief Return the events recorded since start()
+     *
+     * @return QList<BuildTrace::Event>
+     */
+    QList<Event> events() const;
+
+    /**
+     * @brief Return the trace in the Chrome trace event format
+     *
+     * @return QByteArray
+     */
+    QByteArray toChromeTrace() const;
+
+    /**
+     * @brief Save the trace in the Chrome trace event format
+     *
+     * @param fileName File name
+     * @return bool, True if success or False if not
+     */
+    bool save(const QString &fileName) const;
+
+private:
+    QElapsedTimer mTimer;
+    mutable QMutex mMutex;
+    QList<Event> mEvents;
+    QHash<QThread *, int> mThreads;
+};
+
+#endif // BUILDTRACE_H
@@ -32,55 +32,340 @@ This program is free software; you can redistribute it and/or modify
 #include <QFile>
 #include <QFileInfo>
 #include <QRegExp>
+#include <QCryptographicHash>
 #include <QProcess>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QDebug>
 
 #include "IDEApplication.h"
 
 #include "Board.h"
 #include "Toolkit.h"
+#include "LibraryIndex.h"
+#include "SizeAnalyzer.h"
+#include "FirmwareImage.h"
 
 #include "utils/Serial.h"
 #include "utils/Compat.h"
 
+#if ! defined(Q_OS_WIN32) && ! defined(Q_OS_WIN64)
+#include <sys/resource.h>
+#endif
+
+// how often the running commands check whether the build was canceled, in ms
+static const int cancelPollInterval = 100;
+
+/**
+ * @brief Let a started process yield the CPU to the IDE and to the builds
+ *
+ * @param proc Process
+ * @return void
+ */
+static void lowerPriority(QProcess &proc)
+{
+#if defined(Q_OS_WIN32) || defined(Q_OS_WIN64)
+    SetPriorityClass(proc.pid()->hProcess, BELOW_NORMAL_PRIORITY_CLASS);
+#else
+    setpriority(PRIO_PROCESS, proc.pid(), 10);
+#endif
+}
+
+/**
+ * @brief Memory used by a build
+ *
+ */
+struct MemoryUsage
+{
+    quint32 flash;
+    quint32 ram;
+};
+
+// memory used by the last build of each sketch, board and profile, so that
+// the profiles can be compared
+static QMutex usageMutex;
+static QHash<QString, MemoryUsage> lastUsage;
+
+static QString usageKey(const QString &sketch, const QString &board, const QString &profile)
+{
+    return (QStringList(sketch) << board << profile).join("\n");
+}
+
+static QString formatDelta(qint64 delta)
+{
+    return delta > 0 ? QString("+%0").arg(delta) : QString::number(delta);
+}
+
+/**
+ * @brief Compilation of a single translation unit, run on the job pool
+ *
+ */
+class CompileJob : public QRunnable
+{
+public:
+    CompileJob(const QStringList &command, const QString &objectFileName, const QByteArray &key, BuildCache *cache, QSemaphore *tokens, BuildTrace *trace, const QAtomicInt *abort, const QAtomicInt *cancel)
+        : command(command),
+          objectFileName(objectFileName),
+          key(key),
+          exitCode(-1),
+          started(false),
+          skipped(false),
+          claimed(false),
+          follower(false),
+          cache(cache),
+          tokens(tokens),
+          trace(trace),
+          abort(abort),
+          cancel(cancel)
+    {
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        if (tokens != NULL)
+            tokens->acquire();
+
+        // don't start new compilers once a unit failed
+        if (*abort != 0 || *cancel != 0)
+        {
+            if (tokens != NULL)
+                tokens->release();
+            skipped = true;
+            release(QString());
+            finished.release();
+            return;
+        }
+
+        qint64 start = trace->now();
+        QStringList arguments = command;
+        QString program = arguments.takeFirst();
+
+        QProcess proc;
+        proc.setProcessChannelMode(QProcess::MergedChannels);
+        proc.setWorkingDirectory(workingDirectory);
+        proc.start(program, arguments);
+        started = proc.waitForStarted();
+        if (started)
+        {
+            // the compiler is killed when the build is canceled
+            while (proc.state() != QProcess::NotRunning && ! proc.waitForFinished(cancelPollInterval))
+            {
+                if (*cancel != 0)
+                    proc.kill();
+            }
+            output = proc.readAllStandardOutput();
+            if (proc.exitStatus() == QProcess::NormalExit)
+                exitCode = proc.exitCode();
+        }
+        if (tokens != NULL)
+            tokens->release();
+
+        // the source comes last on the command line
+        trace->addEvent(QFileInfo(command.last()).fileName(), "compile", start);
+        release(exitCode == 0 ? store() : QString());
+        finished.release();
+    }
+
+    /**
+     * @brief Let the other builds waiting for the unit use its object
+     *
+     * @param objectPath Object stored in the cache, empty on failure
+     * @return void
+     */
+    void release(const QString &objectPath)
+    {
+        if (claimed)
+        {
+            cache->releaseUnit(key, objectPath);
+            claimed = false;
+        }
+    }
+
+    QStringList command;
+    QString objectFileName;
+    QString workingDirectory;
+    QByteArray key;
+    QByteArray output;
+    int exitCode;
+    bool started;
+    bool skipped;
+    bool claimed;
+    bool follower;
+    QSemaphore finished;
+
+private:
+    /**
+     * @brief Store the object in the cache
+     *
+     * @return QString, the object in the cache, or empty on failure
+     */
+    QString store()
+    {
+        if (key.isEmpty())
+            return QString();
+
+        // the compiler wrote the headers it read next to the object
+        QString depFileName = objectFileName;
+        depFileName.replace(QRegExp("\\.o$"), ".d");
+        QByteArray objectKey;
+        if (cache->recordDependencies(key, depFileName))
+            objectKey = cache->objectKey(key);
+        if (objectKey.isEmpty() || ! cache->store(objectKey, objectFileName))
+        {
+            qWarning() << "Builder: failed to store" << objectFileName << "in the build cache";
+            return QString();
+        }
+        return cache->objectPath(objectKey);
+    }
+
+    BuildCache *cache;
+    QSemaphore *tokens;
+    BuildTrace *trace;
+    const QAtomicInt *abort;
+    const QAtomicInt *cancel;
+};
+
+/**
+ * @brief Times the successive phases of a build, until it goes out of scope
+ *
+ */
+class PhaseTimer
+{
+public:
+    PhaseTimer(Builder *builder)
+        : builder(builder),
+          start(0)
+    {
+    }
+
+    ~PhaseTimer()
+    {
+        next(QString());
+    }
+
+    /**
+     * @brief End the current phase and start another one
+     *
+     * @param phase Name of the next phase, empty to stop
+     * @return void
+     */
+    void next(const QString &phase)
+    {
+        if (! name.isEmpty())
+            builder->endPhase(name, start);
+        name = phase;
+        start = builder->mTrace.now();
+    }
+
+private:
+    Builder *builder;
+    QString name;
+    qint64 start;
+};
+
 Builder::Builder(QObject *parent)
-    : QObject(parent)
+    : QObject(parent),
+      mOwnCache(new BuildCache),
+      mOwnCacheProfile(Toolkit::defaultBuildProfile()),
+      mSharedCache(NULL),
+      mCache(mOwnCache.data()),
+      mCacheHits(0),
+      mCanceled(0),
+      mUploading(false),
+      mLowPriority(false),
+      mJobTokens(NULL),
+      mSketchLines(0),
+      mCheckRevision(-1),
+      mFlashUsage(0),
+      mRamUsage(0)
 {
 }
 
-const Board *Builder::board() const
+Builder::~Builder()
+{
+    discardJobs();
+}
+
+void Builder::setCanceled(bool canceled)
+{
+    mCanceled = canceled ? 1 : 0;
+}
+
+void Builder::setCache(BuildCache *cache)
+{
+    mSharedCache = cache;
+    mCache = cache != NULL ? cache : mOwnCache.data();
+}
+
+QString Builder::profile() const
 {
-    Board::mBoards[name()].setSelectedBoard(name(), mcu(), freq());
+    if (! mProfile.isNull())
+        return mProfile;
+    return ideApp->settings()->buildProfile(mSketchFile);
+}
 
+QString Builder::cachePath(const QString &profile)
+{
+    if (profile == Toolkit::defaultBuildProfile())
+        return BuildCache::defaultPath();
+    return BuildCache::defaultPath(profile);
+}
+
+void Builder::selectCache(const QString &profile)
+{
+    if (mSharedCache != NULL)
+    {
+        mCache = mSharedCache;
+        return;
+    }
+
+    if (profile != mOwnCacheProfile)
+    {
+        mOwnCache.reset(new BuildCache(cachePath(profile)));
+        mOwnCacheProfile = profile;
+    }
+    mCache = mOwnCache.data();
+}
+
+const Board *Builder::board() const
+{
     if(name()=="" or mcu() =="")
         return NULL;
 
-    return Board::boardInfo(name());
+    // builders running in parallel share the selections, which are never
+    // modified once created
+    return Board::selectedBoard(name(), mcu(), freq());
 }
 
 const QString Builder::name() const
 {
-    return ideApp->settings()->board().split(",")[0];
+    return boardSpec().split(",")[0];
 }
 
 const QString Builder::mcu() const
 {
-    if(ideApp->settings()->board().split(",").size()>1)
+    if(boardSpec().split(",").size()>1)
     {
-        return ideApp->settings()->board().split(",")[1];
+        return boardSpec().split(",")[1];
     }
     else
     {
-        return Board::mBoards[name()].mAttributes["build.mcu"];
+        const Board *info = Board::boardInfo(name());
+        return info != NULL ? info->attribute("build.mcu") : QString();
     }
 }
 
 const QString Builder::freq() const
 {
-    if(ideApp->settings()->board().split(",").size()>2)
-        return ideApp->settings()->board().split(",")[2];
+    if(boardSpec().split(",").size()>2)
+        return boardSpec().split(",")[2];
 
-    return Board::mBoards[name()].mAttributes["build.f_cpu"];
+    const Board *info = Board::boardInfo(name());
+    return info != NULL ? info->attribute("build.f_cpu") : QString();
 }
 
 const QString Builder::uploadSpeed() const
@@ -115,121 +400,333 @@ const QString Builder::uploadProtocol() const
 
 const QString Builder::device() const
 {
+    if (! mDevice.isNull())
+        return mDevice;
     return ideApp->settings()->devicePort();
 }
 
-QString Builder::readAllFile(const QString& filepath)
+QString Builder::boardSpec() const
 {
-    QFile file(filepath);
-
-    if(!file.open(QIODevice::ReadOnly))
-        emit logError(tr("Cannot read file '%1'.").arg(file.fileName()));
-
-    return file.readAll();
+    if (! mBoard.isNull())
+        return mBoard;
+    return ideApp->settings()->board();
 }
 
-bool Builder::compileDependencies(QStringList &objects, const QString& code, QStringList& includePaths, QString buildPath, const QStringList& cflags, const QStringList& cxxflags, const QStringList& sflags)
+bool Builder::compileDependencies(QStringList &objects, const QStringList &includes, const QStringList &corePaths, QStringList& includePaths, QString buildPath, const QStringList& cflags, const QStringList& cxxflags, const QStringList& sflags)
 {
-    QRegExp importRegexp("^\\s*#include\\s+[<\"](\\S+)[\">]");
-    foreach (const QString &line, code.split('\n'))
+    LibraryIndex *index = ideApp->libraryIndex();
+    foreach (const QString &include, includes)
     {
-        if (importRegexp.indexIn(line) != -1)
-        {
-            QString library = importRegexp.cap(1);
-            library = QFileInfo(library).baseName();
-            QString libPath = Toolkit::libraryPath(library);
-            QString utilityPath = QDir(libPath).filePath("utility");
-            bool libPathExists = QFileInfo(libPath).exists();
-            bool utilityPathExists = QFileInfo(utilityPath).exists();
-            QStringList libSources, utilitySources;
-
-            if (libPathExists && !includePaths.contains(libPath))
-            {
-                // Add the path of the library we are compiling to the global includePaths
-                includePaths << libPath;
+        LibraryIndex::Library library;
+        if (! index->find(include, library) || includePaths.contains(library.path))
+            continue;
 
-                QString outputDirectory = QDir(buildPath).filePath(library);
-                if (! QDir().mkdir(outputDirectory))
-                {
-                    emit logError(tr("Failed to create build directory."));
-                    return false;
-                }
-                foreach (const QString &source, QDir(utilityPath).entryList(QStringList() << "*.h" << "*.hpp", QDir::Files))
-                {
-                    QString path=QDir(utilityPath).filePath(source);
-                    if (! compileDependencies(objects, readAllFile(path), includePaths, buildPath, cflags, cxxflags, sflags))
-                        return false;
-                }
-                foreach (const QString &source, QDir(libPath).entryList(QStringList() << "*.S" << "*.c" << "*.cpp", QDir::Files))
-                {
-                    QString path=QDir(libPath).filePath(source);
-                    libSources << path;
-                    if (! compileDependencies(objects, readAllFile(path), includePaths, buildPath, cflags, cxxflags, sflags))
-                        return false;
-                }
-                if (! compile(objects, libSources, includePaths, cflags, cxxflags, sflags, outputDirectory))
-                    return false;
-            }
+        // Add the paths of the library we are compiling to the global includePaths
+        includePaths << library.path;
+        if (! library.utilityPath.isEmpty())
+            includePaths << library.utilityPath;
+
+        // the library is compiled against its own include closure, whatever
+        // the sketch including it, so that its objects have the same cache
+        // keys in every sketch
+        QStringList libraryPaths = corePaths;
+        libraryPaths << library.path;
+        if (! library.utilityPath.isEmpty())
+            libraryPaths << library.utilityPath;
+        resolveIncludePaths(libraryPaths, library.includes + library.utilityIncludes);
+
+        QString outputDirectory = QDir(buildPath).filePath(library.name);
+        if (! QDir().mkdir(outputDirectory))
+        {
+            emit logError(tr("Failed to create build directory."));
+            return false;
+        }
+        if (! compileDependencies(objects, library.includes + library.utilityIncludes, corePaths, includePaths, buildPath, cflags, cxxflags, sflags))
+            return false;
+        if (! compile(objects, library.sources, libraryPaths, cflags, cxxflags, sflags, outputDirectory))
+            return false;
 
-            if (utilityPathExists && !includePaths.contains(utilityPath))
+        if (! library.utilityPath.isEmpty())
+        {
+            outputDirectory = QDir(buildPath).filePath(QString("%0/utility").arg(library.name));
+            if (! QDir().mkdir(outputDirectory))
             {
-                // Add the path of the utility we are compiling to the global includePaths
-                includePaths << utilityPath;
-
-                QString outputDirectory = QDir(buildPath).filePath(QString("%0/utility").arg(library));
-                if (! QDir().mkdir(outputDirectory))
-                {
-                    emit logError(tr("Failed to create build directory."));
-                    return false;
-                }
-                foreach (const QString &source, QDir(utilityPath).entryList(QStringList() << "*.h" << "*.hpp", QDir::Files))
-                {
-                    QString path=QDir(utilityPath).filePath(source);
-                    if (! compileDependencies(objects, readAllFile(path), includePaths, buildPath, cflags, cxxflags, sflags))
-                        return false;
-                }
-                foreach (const QString &source, QDir(utilityPath).entryList(QStringList() << "*.S" << "*.c" << "*.cpp", QDir::Files))
-                {
-                    QString path=QDir(utilityPath).filePath(source);
-                    utilitySources << path;
-                    if (! compileDependencies(objects, readAllFile(path), includePaths, buildPath, cflags, cxxflags, sflags))
-                        return false;
-                }
-                if (! compile(objects, utilitySources, includePaths, cflags, cxxflags, sflags, outputDirectory))
-                    return false;
+                emit logError(tr("Failed to create build directory."));
+                return false;
             }
+            if (! compile(objects, library.utilitySources, libraryPaths, cflags, cxxflags, sflags, outputDirectory))
+                return false;
         }
     }
 
     return true;
 }
 
+void Builder::resolveIncludePaths(QStringList &includePaths, const QStringList &includes)
+{
+    LibraryIndex *index = ideApp->libraryIndex();
+    foreach (const QString &include, includes)
+    {
+        LibraryIndex::Library library;
+        if (! index->find(include, library))
+            continue;
+
+        if (! includePaths.contains(library.path))
+        {
+            includePaths << library.path;
+            resolveIncludePaths(includePaths, library.includes);
+        }
+        if (! library.utilityPath.isEmpty() && ! includePaths.contains(library.utilityPath))
+        {
+            includePaths << library.utilityPath;
+            resolveIncludePaths(includePaths, library.utilityIncludes);
+        }
+    }
+}
+
+QString Builder::sketchHeader()
+{
+    QString path1 = Toolkit::hardwarePath()+"/arduino/avr/cores/arduino/Arduino.h";
+    QString path2 = Toolkit::hardwarePath()+"/arduino/cores/arduino/Arduino.h";
+    if (QFileInfo(path1).exists() || QFileInfo(path2).exists())
+        return "Arduino.h";
+    else
+        return "WProgram.h";
+}
+
 bool Builder::build(const QString &code, bool upload)
 {
-    if (board() == NULL)
+    mTrace.start();
+    bool success;
     {
-        emit logError(tr("No board selected."));
-        return false;
+        PhaseTimer phase(this);
+        phase.next(tr("Build"));
+        success = runBuild(code, upload);
     }
+    // a failed build may leave units other builds are waiting for
+    discardJobs();
 
-    if (upload && device().isEmpty())
+    if (! success && isCanceled() && ! mUploading)
+    {
+        // nothing of a canceled build is kept, remove its partial objects
+        mBuildDir.reset();
+        mHexFileName.clear();
+        mEepromFileName.clear();
+        emit logImportant(tr("Build canceled."));
+    }
+    saveTrace();
+    return success;
+}
+
+bool Builder::checkSyntax(const QString &code)
+{
+    mTrace.start();
+    mUploading = false;
+    mDiagnostics.clear();
+    if (isCanceled() || board() == NULL)
+        return false;
+
+    // the directory is kept from one check to the next
+    if (mBuildDir.isNull())
+        mBuildDir.reset(new QxtTemporaryDir(QDir(QDir::tempPath()).filePath("arduino-check")));
+
+    QStringList cxxflags = Toolkit::avrCxxFlags(board(), profile());
+    cxxflags.removeAll("-MMD");
+    cxxflags << "-include" << sketchHeader();
+
+    // the libraries are only needed for their headers
+    QStringList includes = sketchIncludes(code);
+    QString corePath = Toolkit::corePath(board());
+    LibraryIndex *index = ideApp->libraryIndex();
+    index->update();
+    if (includes != mCheckIncludes || corePath != mCheckCorePath || index->revision() != mCheckRevision)
     {
-        emit logError(tr("No device selected."));
+        mCheckIncludePaths = QStringList() << corePath;
+        resolveIncludePaths(mCheckIncludePaths, includes);
+        mCheckIncludes = includes;
+        mCheckCorePath = corePath;
+        mCheckRevision = index->revision();
+    }
+
+    if (! writeSketch(code, mBuildDir->path()))
         return false;
+
+    QStringList command;
+    command << Toolkit::avrTool(Toolkit::AvrGxx) << "-fsyntax-only" << cxxflags;
+    foreach (const QString &path, mCheckIncludePaths)
+        command << QString("-I%0").arg(path);
+    if (! mSketchFile.isEmpty())
+        command << QString("-I%0").arg(QFileInfo(mSketchFile).absolutePath());
+    command << mSourceFileName;
+
+    mLowPriority = true;
+    bool success = runCommand(command, true) == 0;
+    mLowPriority = false;
+    return success;
+}
+
+bool Builder::writeSketch(const QString &code, const QString &directory)
+{
+    // the main file comes first, then the other .ino and .pde files
+    QStringList codes = QStringList() << code;
+    QStringList names = QStringList() << (mSketchFile.isEmpty() ? QString("sketch.ino") : QFileInfo(mSketchFile).fileName());
+    foreach (const QString &fileName, sketchFiles())
+    {
+        if (! fileName.endsWith(".ino") && ! fileName.endsWith(".pde"))
+            continue;
+
+        QFile file(fileName);
+        if (! file.open(QIODevice::ReadOnly))
+            return fail(tr("Cannot read %0: %1").arg(QFileInfo(fileName).fileName(), file.errorString()));
+        codes << QString::fromLocal8Bit(file.readAll());
+        names << QFileInfo(fileName).fileName();
     }
 
-    emit logImportant(tr("Compiling for %0...").arg(name()));
+    // the files are kept for the compiler to quote their lines, the #line
+    // directives of the source refer to them relatively to the build
+    // directory, so that the source does not depend on where it is built
+    for (int i = 0; i < codes.size(); i++)
+    {
+        QFile file(QDir(directory).filePath(names.at(i)));
+        if (! file.open(QIODevice::WriteOnly))
+            return fail(tr("Can't write the sketch to disk."));
+        file.write(codes.at(i).toLocal8Bit());
+    }
+
+    mSketchFileName = QFileInfo(QDir(directory).filePath(names.first())).absoluteFilePath();
+    mSourceFileName = mSketchFileName + ".cpp";
+    mSketchLines = code.count('\n') + 1;
+
+    QFile sourceFile(mSourceFileName);
+    if (! sourceFile.open(QIODevice::WriteOnly))
+        return fail(tr("Can't write the sketch to disk."));
+    sourceFile.write(mPreprocessor.process(codes, names).toLocal8Bit());
+
+    // if main.cxx exists, append it to the source
+    QString sketchMainFileName = QDir(Toolkit::corePath(board())).filePath("main.cxx");
+    if (QFileInfo(sketchMainFileName).exists())
+    {
+        QFile sketchMain(sketchMainFileName);
+        if (! sketchMain.open(QIODevice::ReadOnly))
+            return fail(tr("Can't open main.cxx."));
+        sourceFile.write(QString("#line 1 \"%0\"\n").arg(sketchMainFileName).toLocal8Bit());
+        sourceFile.write(sketchMain.readAll());
+    }
+    return true;
+}
+
+QStringList Builder::sketchFiles() const
+{
+    static const QStringList filters = QStringList()
+        << "*.ino" << "*.pde" << "*.c" << "*.cpp" << "*.S" << "*.h" << "*.hpp";
+
+    QStringList files;
+    if (mSketchFile.isEmpty())
+        return files;
+
+    QFileInfo info(mSketchFile);
+    QDir dir = info.absoluteDir();
+    foreach (const QString &name, dir.entryList(filters, QDir::Files | QDir::CaseSensitive, QDir::Name))
+    {
+        if (name != info.fileName())
+            files << dir.absoluteFilePath(name);
+    }
+    return files;
+}
+
+QStringList Builder::sketchIncludes(const QString &code) const
+{
+    QStringList includes = LibraryIndex::scanIncludes(code.toLocal8Bit());
+    foreach (const QString &fileName, sketchFiles())
+    {
+        QFile file(fileName);
+        if (! file.open(QIODevice::ReadOnly))
+            continue;
+
+        foreach (const QString &include, LibraryIndex::scanIncludes(file.readAll()))
+        {
+            if (! includes.contains(include))
+                includes << include;
+        }
+    }
+    return includes;
+}
+
+bool Builder::fail(const QString &message)
+{
+    // the errors of a canceled build only come from the cancellation
+    if (! isCanceled())
+        emit logError(message);
+    return false;
+}
+
+void Builder::endPhase(const QString &name, qint64 start)
+{
+    qint64 duration = mTrace.addEvent(name, "phase", start);
+    emit phaseFinished(name, duration / 1000);
+}
+
+void Builder::saveTrace()
+{
+    QString fileName = mTraceFileName;
+    if (fileName.isEmpty() && ideApp->settings()->buildTiming())
+        fileName = QDir(mCache->path()).filePath("trace.json");
+    if (fileName.isEmpty())
+        return;
+
+    QDir().mkpath(QFileInfo(fileName).path());
+
+    if (mTrace.save(fileName))
+        emit log(tr("Build trace saved to %0.").arg(fileName));
+    else
+        emit logError(tr("Cannot save the build trace to %0.").arg(fileName));
+}
+
+bool Builder::runBuild(const QString &code, bool upload)
+{
+    PhaseTimer phase(this);
+
+    QString profile = this->profile();
+    selectCache(profile);
+    mUploading = false;
+    mFlashUsage = 0;
+    mRamUsage = 0;
+    if (isCanceled())
+        return false;
+
+    if (board() == NULL)
+        return fail(tr("No board selected."));
+
+    if (! Toolkit::buildProfiles().contains(profile))
+        return fail(tr("Unknown build profile %0, the known profiles are: %1.").arg(profile, Toolkit::buildProfiles().join(", ")));
+
+    if (upload && device().isEmpty())
+        return fail(tr("No device selected."));
+
+    if (profile == Toolkit::defaultBuildProfile())
+        emit logImportant(tr("Compiling for %0...").arg(name()));
+    else
+        emit logImportant(tr("Compiling for %0, %1 profile...").arg(name(), profile));
     mBuildDir.reset(new QxtTemporaryDir(QDir(QDir::tempPath()).filePath("arduino-build")));
     QString buildPath = mBuildDir->path();
-
-    QStringList cflags = Toolkit::avrCFlags(board());
-    QStringList cxxflags = Toolkit::avrCxxFlags(board());
+    mCache->reset();
+    mSketchFileName.clear();
+    mSketchLines = 0;
+    mCacheHits = 0;
+    mObjectNames.clear();
+    mHexFileName.clear();
+    mEepromFileName.clear();
+    mDiagnostics.clear();
+    discardJobs();
+
+    QStringList cflags = Toolkit::avrCFlags(board(), profile);
+    QStringList cxxflags = Toolkit::avrCxxFlags(board(), profile);
     QStringList sflags = Toolkit::avrSFlags(board());
-    QStringList ldflags = Toolkit::avrLdFlags(board());
-    QStringList sizeflags = Toolkit::avrSizeFlags(board());
+    QStringList ldflags = Toolkit::avrLdFlags(board(), profile);
     QStringList includePaths;
 
     // compile the core
+    phase.next(tr("Core"));
     QStringList objects;
     QString corePath = Toolkit::corePath(board());
     includePaths << corePath;
@@ -238,101 +735,102 @@ bool Builder::build(const QString &code, bool upload)
     foreach (const QString &source, coreDir.entryList(QStringList() << "*.S" << "*.c" << "*.cpp", QDir::Files))
         coreSources.append(coreDir.filePath(source));
 
-    bool success;
-    success = compile(objects, coreSources, includePaths, cflags, cxxflags, sflags);
+    // the core only depends on the board configuration: reuse the archive
+    // built for this configuration as long as its sources did not change
+    QByteArray coreKey = coreArchiveKey(cflags, sflags);
+    QByteArray coreManifest = BuildCache::coreManifest(QStringList() << corePath << Toolkit::variantPath(board()));
+    bool prebuiltCore = mCache->containsCoreArchive(coreKey, coreManifest);
+
+    // the core, the libraries and the sketch are independent from each other:
+    // queue all of them and let the job pool compile them together
+    QStringList coreObjects;
+    bool success = true;
+    if (prebuiltCore)
+        emit log(tr("Using the prebuilt core for %0.").arg(name()));
+    else
+        success = compile(coreObjects, coreSources, includePaths, cflags, cxxflags, sflags);
     if (! success)
-    {
-        emit logError(tr("Compilation failed."));
-        return false;
-    }
-
-    QString coreFileName = QDir(buildPath).filePath("core.a");
-    if (! archive(coreFileName, objects))
-    {
-        emit logError(tr("Archiving failed."));
-        return false;
-    }
-    objects.clear();
+        return fail(tr("Compilation failed."));
 
-    // compile the libraries
-    QString path1 = Toolkit::hardwarePath()+"/arduino/avr/cores/arduino/Arduino.h";
-    QString path2 = Toolkit::hardwarePath()+"/arduino/cores/arduino/Arduino.h";
-    if (QFileInfo(path1).exists() || QFileInfo(path2).exists())
-        cxxflags << "-include" << "Arduino.h";
-    else
-        cxxflags << "-include" << "WProgram.h";
+    // compile the libraries, the other sources of the sketch are compiled
+    // as they are, without the header of the core
+    QStringList sourceCxxflags = cxxflags;
+    cxxflags << "-include" << sketchHeader();
 
-    success = compileDependencies(objects, code, includePaths, buildPath, cflags, cxxflags, sflags);
+    phase.next(tr("Library discovery"));
+    ideApp->libraryIndex()->update();
+    success = compileDependencies(objects, sketchIncludes(code), QStringList() << corePath, includePaths, buildPath, cflags, cxxflags, sflags);
     if (! success)
-    {
-        emit logError(tr("Compilation failed."));
+        return fail(tr("Compilation failed."));
+
+    // compile the sketch, which may include headers of its folder
+    phase.next(tr("Preprocess"));
+    if (! writeSketch(code, buildPath))
         return false;
-    }
 
-    // compile the sketch
-    QString sketchFileName = QDir(buildPath).filePath("sketch.cpp");
-    QFile sketchFile(sketchFileName);
-    if (! sketchFile.open(QIODevice::WriteOnly))
+    QStringList sketchIncludePaths = includePaths;
+    if (! mSketchFile.isEmpty())
+        sketchIncludePaths << QFileInfo(mSketchFile).absolutePath();
+    compile(objects, QStringList() << mSourceFileName, sketchIncludePaths, cflags, cxxflags, sflags);
+    if (objects.isEmpty())
+        return fail(tr("Compilation failed."));
+
+    // each source of the sketch folder is a unit of its own, with its own
+    // entry in the build cache
+    QStringList sketchSources;
+    foreach (const QString &fileName, sketchFiles())
     {
-        emit logError(tr("Can't write the sketch to disk."));
-        return false;
+        if (identifySource(fileName) != UnknownSource)
+            sketchSources << fileName;
     }
-    sketchFile.write(code.toLocal8Bit());
-
-    // if main.cxx exists, append it to the source
-    QString sketchMainFileName = QDir(corePath).filePath("main.cxx");
-    if (QFileInfo(sketchMainFileName).exists())
+    if (! sketchSources.isEmpty())
     {
-        QFile sketchMain(sketchMainFileName);
-        if (! sketchMain.open(QIODevice::ReadOnly))
-        {
-            emit logError(tr("Can't open main.cxx."));
-            sketchFile.close();
-            return false;
-        }
-        sketchFile.write(sketchMain.readAll());
-        sketchMain.close();
+        QString outputDirectory = QDir(buildPath).filePath("sketch");
+        if (! QDir().mkdir(outputDirectory))
+            return fail(tr("Failed to create build directory."));
+        compile(objects, sketchSources, sketchIncludePaths, cflags, sourceCxxflags, sflags, outputDirectory);
     }
 
-    sketchFile.close();
+    phase.next(tr("Compile"));
+    if (! runCompileJobs())
+        return fail(tr("Compilation failed."));
 
-    compile(objects, QStringList() << sketchFileName, includePaths, cflags, cxxflags, sflags);
-    if (objects.isEmpty())
+    if (mCacheHits > 0)
+        emit log(tr("%0 object(s) reused from the build cache.").arg(mCacheHits));
+
+    QString coreFileName = mCache->coreArchivePath(coreKey);
+    if (! prebuiltCore)
     {
-        emit logError(tr("Compilation failed."));
-        return false;
+        phase.next(tr("Archive"));
+        coreFileName = QDir(buildPath).filePath("core.a");
+        if (! archive(coreFileName, coreObjects, profile == "lto"))
+            return fail(tr("Archiving failed."));
+        if (! coreKey.isEmpty() && ! mCache->storeCoreArchive(coreKey, coreManifest, coreFileName))
+            qWarning() << "Builder: failed to store the core archive in the build cache";
     }
 
     // link it all together into the .elf file
+    phase.next(tr("Link"));
     emit logImportant(tr("Linking..."));
     QString elfFileName = QDir(buildPath).filePath("sketch.elf");
+    QString mapFileName = QDir(buildPath).filePath("sketch.map");
+    ldflags << QString("-Wl,-Map,%0").arg(mapFileName);
     if (! link(elfFileName, QStringList() << objects << coreFileName, ldflags))
-    {
-        emit logError(tr("Link failed."));
-        return false;
-    }
+        return fail(tr("Link failed."));
 
     // display size of the .elf file
+    phase.next(tr("Size"));
     emit logImportant(tr("Sizing..."));
-    if (! size(elfFileName, QStringList() << sizeflags))
-    {
-        emit logError(tr("Sizing failed."));
-    }
-    // extract EEPROM
+    if (! size(elfFileName, mapFileName))
+        return fail(tr("The sketch does not fit in the memory of the board."));
+    // extract HEX and EEPROM
+    phase.next(tr("Extract images"));
     QString eepFileName = QDir(buildPath).filePath("sketch.eep");
-    if (! extractEEPROM(elfFileName, eepFileName))
-    {
-        emit logError(tr("Failed to extract EEPROM."));
-        return false;
-    }
-
-    // extract HEX
     QString hexFileName = QDir(buildPath).filePath("sketch.hex");
-    if (! extractHEX(elfFileName, hexFileName))
-    {
-        emit logError(tr("Failed to extract HEX."));
+    if (! extractImages(elfFileName, hexFileName, eepFileName))
         return false;
-    }
+    mHexFileName = hexFileName;
+    mEepromFileName = eepFileName;
 
     if (! upload)
     {
@@ -340,8 +838,12 @@ bool Builder::build(const QString &code, bool upload)
         return true;
     }
 
-    // upload
+    // upload, which can't be canceled once started
+    if (isCanceled())
+        return false;
+    phase.next(tr("Upload"));
     emit logImportant(tr("Uploading to %0...").arg(device()));
+    mUploading = true;
     if (! uploadViaBootloader(hexFileName))
     {
         emit logError(tr("Uploading failed."));
@@ -363,48 +865,181 @@ bool Builder::compile(QStringList &objects, const QStringList &sources, const QS
 
     foreach (const QString &source, sources)
     {
-        QStringList cmdline;
+        QString compiler;
+        QStringList arguments;
         SourceType sourceType = identifySource(source);
         QString objectFileName = QFileInfo(source).fileName() + ".o";
         objectFileName = QDir(outputDirectory.isNull() ? mBuildDir->path() : outputDirectory).filePath(objectFileName);
         switch (sourceType)
         {
         case CSource:
-            cmdline
-                << Toolkit::avrTool(Toolkit::AvrGcc) << "-c"
-                << cflags << includeFlags
-                << "-o" << objectFileName << source;
+            compiler = Toolkit::avrTool(Toolkit::AvrGcc);
+            arguments << cflags << includeFlags;
             break;
         case CxxSource:
-            cmdline
-                << Toolkit::avrTool(Toolkit::AvrGxx) << "-c"
-                << cxxflags << includeFlags
-                << "-o" << objectFileName << source;
+            compiler = Toolkit::avrTool(Toolkit::AvrGxx);
+            arguments << cxxflags << includeFlags;
             break;
         case SSource:
-            cmdline
-                << Toolkit::avrTool(Toolkit::AvrGcc) << "-c"
-                << sflags << includeFlags
-                << "-o" << objectFileName << source;
+            compiler = Toolkit::avrTool(Toolkit::AvrGcc);
+            arguments << sflags << includeFlags;
             break;
         default:
             emit logError(tr("Unknown source type: %0").arg(QFileInfo(source).fileName()));
             continue;
         }
 
-        if (runCommand(cmdline, true) != 0)
-            return false;
-        else
-            objects << objectFileName;
+        // name of the object in the size report, relative to the build directory
+        QString displayName = QDir(mBuildDir->path()).relativeFilePath(objectFileName);
+        displayName.chop(2);
+
+        // reuse the object of a previous build when neither the source nor
+        // the headers it included changed
+        QByteArray key = mCache->key(compiler, arguments, source);
+        QByteArray objectKey = mCache->objectKey(key);
+        if (mCache->contains(objectKey))
+        {
+            objects << mCache->objectPath(objectKey);
+            mObjectNames.insert(objects.last(), displayName);
+            mCacheHits++;
+            continue;
+        }
+
+        QStringList cmdline;
+        cmdline
+            << compiler << "-c"
+            << arguments
+            << "-o" << objectFileName << source;
+
+        CompileJob *job = new CompileJob(cmdline, objectFileName, key, mCache, mJobTokens, &mTrace, &mAbortJobs, &mCanceled);
+        job->workingDirectory = mBuildDir->path();
+        mJobs << job;
+
+        // another build sharing the cache may already be compiling the same
+        // unit, runCompileJobs() then waits for its object
+        if (! key.isEmpty())
+        {
+            job->claimed = mCache->claimUnit(key);
+            job->follower = ! job->claimed;
+        }
+        objects << objectFileName;
+        mObjectNames.insert(objectFileName, displayName);
     }
 
     return true;
 }
 
-bool Builder::archive(const QString &fileName, const QStringList &objects)
+int Builder::jobCount()
+{
+    int count = ideApp->settings()->buildJobs();
+    if (count <= 0)
+        count = QThread::idealThreadCount();
+    return qMax(count, 1);
+}
+
+bool Builder::runCompileJobs()
 {
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobCount());
+
+    mAbortJobs = 0;
+    foreach (CompileJob *job, mJobs)
+    {
+        if (! job->follower)
+            pool.start(job);
+    }
+
+    // report the jobs in the order they were queued, whatever the order in
+    // which they finish
+    bool success = true;
+    foreach (CompileJob *job, mJobs)
+    {
+        if (job->follower)
+        {
+            if (isCanceled())
+            {
+                success = false;
+                continue;
+            }
+
+            // reuse the object compiled by the other build, or compile the
+            // unit here to report its errors if that build failed
+            QString objectPath = mCache->waitForUnit(job->key);
+            if (! objectPath.isEmpty())
+            {
+                QFile::remove(job->objectFileName);
+                if (QFile::copy(objectPath, job->objectFileName))
+                {
+                    mCacheHits++;
+                    continue;
+                }
+            }
+            job->run();
+        }
+        else
+            job->finished.acquire();
+        if (job->skipped)
+            continue;
+
+        // the output of the killed compilers is meaningless
+        if (isCanceled())
+        {
+            success = false;
+            continue;
+        }
+
+        emit logCommand(job->command);
+        if (! job->started)
+            emit logError(tr("Cannot start program %1").arg(job->command.first()));
+        mDiagnosticParser.reset();
+        logOutput(QString::fromLocal8Bit(job->output), true);
+
+        if (job->exitCode != 0)
+        {
+            success = false;
+            mAbortJobs = 1;
+        }
+    }
+    pool.waitForDone();
+
+    if (! mCache->save())
+        qWarning() << "Builder: failed to save the dependencies of the build cache";
+
+    discardJobs();
+    return success;
+}
+
+void Builder::discardJobs()
+{
+    foreach (CompileJob *job, mJobs)
+        job->release(QString());
+    qDeleteAll(mJobs);
+    mJobs.clear();
+}
+
+QByteArray Builder::coreArchiveKey(const QStringList &cflags, const QStringList &sflags)
+{
+    QByteArray version = BuildCache::toolchainVersion(Toolkit::avrTool(Toolkit::AvrGcc));
+    if (version.isEmpty())
+        return QByteArray();
+
+    QStringList configuration;
+    configuration
+        << name() << mcu() << freq()
+        << QString::number(Toolkit::toolkitVersionInt(ideApp->settings()->arduinoPath()))
+        << board()->attribute("build.variant")
+        << Toolkit::corePath(board())
+        << QString::fromLatin1(version)
+        << cflags << sflags;
+    return QCryptographicHash::hash(configuration.join("\n").toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+bool Builder::archive(const QString &fileName, const QStringList &objects, bool lto)
+{
+    // only the wrapper loading the linker plugin indexes the symbols of
+    // link-time optimized objects
     QStringList command;
-    command << Toolkit::avrTool(Toolkit::AvrAr) << "rcs" << fileName << objects;
+    command << Toolkit::avrTool(lto ? Toolkit::AvrGccAr : Toolkit::AvrAr) << "rcs" << fileName << objects;
     return runCommand(command) == 0;
 }
 
@@ -433,27 +1068,106 @@ bool Builder::link(const QString &fileName, const QStringList &objects, const QS
     return runCommand(command) == 0;
 }
 
-bool Builder::size(const QString &fileName, const QStringList &sizeflags)
+bool Builder::size(const QString &elfFileName, const QString &mapFileName)
 {
-    QStringList command;
-    command
-        << Toolkit::avrTool(Toolkit::AvrSize)
-        << sizeflags
-        << fileName;
-    return runCommand(command) == 0;
+    SizeAnalyzer analyzer;
+    analyzer.setObjectNames(mObjectNames);
+    if (! analyzer.analyze(elfFileName, mapFileName))
+    {
+        emit logError(tr("Sizing failed: %0").arg(analyzer.errorString()));
+        return true;
+    }
+
+    quint32 flash = analyzer.flashUsage();
+    quint32 ram = analyzer.ramUsage();
+    quint32 maxFlash = board()->attribute("upload.maximum_size").toUInt();
+    quint32 maxRam = board()->attribute("upload.maximum_data_size").toUInt();
+    if (maxRam == 0)
+        maxRam = SizeAnalyzer::ramSize(mcu());
+
+    QStringList report;
+    if (maxFlash > 0)
+        report << tr("Program: %0 bytes (%1% of %2 bytes)").arg(flash).arg(100.0 * flash / maxFlash, 0, 'f', 1).arg(maxFlash);
+    else
+        report << tr("Program: %0 bytes").arg(flash);
+    if (maxRam > 0)
+        report << tr("Data: %0 bytes (%1% of %2 bytes)").arg(ram).arg(100.0 * ram / maxRam, 0, 'f', 1).arg(maxRam);
+    else
+        report << tr("Data: %0 bytes").arg(ram);
+    if (analyzer.eepromSize() > 0)
+        report << tr("EEPROM: %0 bytes").arg(analyzer.eepromSize());
+
+    // compare with the last build of the other profiles
+    if (! mSketchFile.isEmpty())
+    {
+        QString profile = this->profile();
+        QString sketch = QFileInfo(mSketchFile).absoluteFilePath();
+        QMutexLocker locker(&usageMutex);
+        foreach (const QString &other, Toolkit::buildProfiles())
+        {
+            QHash<QString, MemoryUsage>::const_iterator it = lastUsage.constFind(usageKey(sketch, boardSpec(), other));
+            if (other == profile || it == lastUsage.constEnd())
+                continue;
+            report << tr("Compared to the %0 profile: program %1 bytes, data %2 bytes")
+                .arg(other, formatDelta(qint64(flash) - it->flash), formatDelta(qint64(ram) - it->ram));
+        }
+        MemoryUsage usage;
+        usage.flash = flash;
+        usage.ram = ram;
+        lastUsage.insert(usageKey(sketch, boardSpec(), profile), usage);
+    }
+    emit log(report.join("\n"));
+
+    // what takes the most room
+    static const int reportedItems = 10;
+    static const QString itemFormat("%1 %2  %3");
+    report.clear();
+    report << tr("Largest objects (flash, RAM):");
+    foreach (const SizeAnalyzer::Item &item, analyzer.objects().mid(0, reportedItems))
+        report << itemFormat.arg(item.flash, 7).arg(item.ram, 7).arg(item.name);
+    report << tr("Largest symbols (flash, RAM):");
+    foreach (const SizeAnalyzer::Item &item, analyzer.symbols().mid(0, reportedItems))
+        report << itemFormat.arg(item.flash, 7).arg(item.ram, 7).arg(item.name);
+    emit log(report.join("\n"));
+
+    bool fits = true;
+    if (maxFlash > 0 && flash > maxFlash)
+    {
+        emit logError(tr("The program is %0 bytes too big.").arg(flash - maxFlash));
+        fits = false;
+    }
+    if (maxRam > 0 && ram > maxRam)
+    {
+        emit logError(tr("The global variables use %0 bytes more than the RAM.").arg(ram - maxRam));
+        fits = false;
+    }
+    if (fits)
+    {
+        mFlashUsage = flash;
+        mRamUsage = ram;
+    }
+    return fits;
 }
 
 int Builder::runCommand(const QStringList &command, bool errorHighlighting)
 {
+    if (isCanceled() && ! mUploading)
+        return -1;
+
     emit logCommand(command);
+    mDiagnosticParser.reset();
 
+    qint64 start = mTrace.now();
     QStringList arguments = command;
     QString program = arguments.takeFirst();
 
     QProcess proc;
     proc.setProcessChannelMode(QProcess::MergedChannels);
+    if (! mBuildDir.isNull())
+        proc.setWorkingDirectory(mBuildDir->path());
     proc.start(program, arguments);
-    proc.waitForStarted();
+    if (proc.waitForStarted() && mLowPriority)
+        lowerPriority(proc);
     QProcess::ProcessError error = proc.error();
 
     if (error == QProcess::FailedToStart || error == QProcess::Crashed)
@@ -463,55 +1177,104 @@ int Builder::runCommand(const QStringList &command, bool errorHighlighting)
     }
     else
     {
+        // log the output as it comes, one batch of complete lines at a time
+        QByteArray pending;
+        while (proc.state() != QProcess::NotRunning || proc.bytesAvailable() > 0)
+        {
+            if (proc.bytesAvailable() == 0)
+                proc.waitForReadyRead(cancelPollInterval);
+            if (isCanceled() && ! mUploading && proc.state() != QProcess::NotRunning)
+                proc.kill();
+            pending += proc.readAll();
+
+            int end = pending.lastIndexOf('\n');
+            if (end >= 0)
+            {
+                logOutput(QString::fromLocal8Bit(pending.constData(), end), errorHighlighting);
+                pending.remove(0, end + 1);
+            }
+        }
         proc.waitForFinished();
+        logOutput(QString::fromLocal8Bit(pending), errorHighlighting);
+        mTrace.addEvent(QFileInfo(program).fileName(), "process", start);
 
         error = proc.error();
-        if (error == QProcess::Crashed)
+        if (error == QProcess::Crashed || (isCanceled() && ! mUploading))
             return -1;
 
-        if (! errorHighlighting)
-            emit log(QString::fromLocal8Bit(proc.readAllStandardOutput()));
-        else
+        return proc.exitCode();
+    }
+}
+
+void Builder::logOutput(const QString &output, bool errorHighlighting)
+{
+    if (! errorHighlighting)
+        emit log(output);
+    else
+    {
+        // consecutive ordinary lines are sent at once
+        QStringList lines;
+        foreach (QString line, output.split('\n'))
         {
-            foreach (QString line, QString::fromLocal8Bit(proc.readAllStandardOutput()).split('\n'))
+            if (line.endsWith('\r'))
+                line.chop(1);
+
+            Diagnostic diagnostic;
+            if (mDiagnosticParser.parseLine(line, diagnostic))
             {
-                if (line.contains(QRegExp(".*\\.cpp:\\d+: error:")))
+                if (! lines.isEmpty())
+                {
+                    emit log(lines.join("\n"));
+                    lines.clear();
+                }
+                if (diagnostic.severity == Diagnostic::Error)
                     emit logError(line);
-                else if (line.contains(QRegExp(".*\\.cpp:\\d+: (warning|note):")))
-                    emit logImportant(line);
                 else
-                    emit log(line);
+                    emit logImportant(line);
+
+                // the sketch is compiled from a copy in the build directory,
+                // the compiler runs from there
+                if (! mSketchFileName.isEmpty() && ! mBuildDir.isNull())
+                {
+                    QString fileName = QFileInfo(QDir(mBuildDir->path()), diagnostic.fileName).absoluteFilePath();
+                    if (fileName == mSourceFileName && mPreprocessor.sketchLine(diagnostic.line) > 0)
+                    {
+                        diagnostic.line = mPreprocessor.sketchLine(diagnostic.line);
+                        fileName = mSketchFileName;
+                    }
+                    if (fileName == mSketchFileName && diagnostic.line <= mSketchLines)
+                        diagnostic.inSketch = true;
+                }
+                mDiagnostics << diagnostic;
+                emit diagnosticFound(diagnostic);
             }
+            else if (! line.isEmpty())
+                lines << line;
         }
-
-        return proc.exitCode();
+        if (! lines.isEmpty())
+            emit log(lines.join("\n"));
     }
 }
 
-bool Builder::extractEEPROM(const QString &input, const QString &output)
-{
-    QStringList command;
-    command
-        << Toolkit::avrTool(Toolkit::AvrObjcopy)
-        << "-O" << "ihex"
-        << "-j" << ".eeprom"
-        << "--set-section-flags=.eeprom=alloc,load"
-        <<"--no-change-warnings"
-        << "--change-section-lma"
-        << ".eeprom=0"
-        << input << output;
-    return runCommand(command) == 0;
-}
-
-bool Builder::extractHEX(const QString &input, const QString &output)
+bool Builder::extractImages(const QString &input, const QString &hexOutput, const QString &eepromOutput)
 {
-    QStringList command;
-    command
-        << Toolkit::avrTool(Toolkit::AvrObjcopy)
-        << "-O" << "ihex"
-        << "-R" << ".eeprom"
-        << input << output;
-    return runCommand(command) == 0;
+    FirmwareImage image;
+    if (! image.load(input))
+    {
+        emit logError(tr("Cannot read %0: %1").arg(QFileInfo(input).fileName(), image.errorString()));
+        return false;
+    }
+    if (! image.saveEeprom(eepromOutput))
+    {
+        emit logError(tr("Failed to extract EEPROM."));
+        return false;
+    }
+    if (! image.saveFlash(hexOutput))
+    {
+        emit logError(tr("Failed to extract HEX."));
+        return false;
+    }
+    return true;
 }
 
 bool Builder::uploadViaBootloader(const QString &hexFileName)
@@ -544,43 +1307,110 @@ bool Builder::uploadViaBootloader(const QString &hexFileName)
         Compat::sleep_ms(1000);
     }
 
+    if (ideApp->settings()->verboseUpload())
+    {
+        QString version = Toolkit::avrdudeVersion();
+        if (! version.isEmpty())
+            emit log(tr("Using avrdude %0.").arg(version));
+    }
+
     return runCommand(command) == 0;
 }
 
-BackgroundBuilder::BackgroundBuilder(QObject *parent) : builder(parent),
-                                                        actions(NULL)
+BackgroundBuilder::BackgroundBuilder(QObject *parent)
+    : QThread(parent),
+      pending(false),
+      running(false),
+      mode(BuildMode)
 {
     connect(&builder, SIGNAL(log(QString)), this, SIGNAL(log(QString)));
     connect(&builder, SIGNAL(logCommand(QStringList)), this, SIGNAL(logCommand(QStringList)));
     connect(&builder, SIGNAL(logError(QString)), this, SIGNAL(logError(QString)));
     connect(&builder, SIGNAL(logImportant(QString)), this, SIGNAL(logImportant(QString)));
+    connect(&builder, SIGNAL(diagnosticFound(Diagnostic)), this, SIGNAL(diagnosticFound(Diagnostic)));
+    connect(&builder, SIGNAL(phaseFinished(QString, qint64)), this, SIGNAL(phaseFinished(QString, qint64)));
+}
+
+BackgroundBuilder::~BackgroundBuilder()
+{
+    cancel();
+    wait();
+}
+
+void BackgroundBuilder::backgroundBuild(const QString &code, bool upload, const QString &fileName)
+{
+    request(code, fileName, upload ? UploadMode : BuildMode);
 }
 
-void BackgroundBuilder::setRelatedActions(QActionGroup *actions)
+void BackgroundBuilder::backgroundCheck(const QString &code, const QString &fileName)
 {
-    this->actions = actions;
+    request(code, fileName, CheckMode);
 }
 
-void BackgroundBuilder::backgroundBuild(const QString &code, bool upload)
+void BackgroundBuilder::request(const QString &code, const QString &fileName, Mode mode)
 {
-    if (isRunning())
+    QMutexLocker locker(&mutex);
+    this->code = code;
+    this->fileName = fileName;
+    this->mode = mode;
+    pending = true;
+
+    // the running build is stale, run() starts this one once it returns
+    if (running)
     {
-        qWarning() << "BackgroundBuilder thread already running.";
-        emit buildFinished(false);
+        builder.setCanceled(true);
         return;
     }
 
-    this->code = code;
-    this->upload = upload;
+    // the previous run() may still be returning
+    running = true;
+    wait();
+    start(mode == CheckMode ? QThread::LowestPriority : QThread::InheritPriority);
+}
 
-    start();
+void BackgroundBuilder::cancel()
+{
+    QMutexLocker locker(&mutex);
+    pending = false;
+    if (running)
+        builder.setCanceled(true);
 }
 
 void BackgroundBuilder::run()
 {
-    actions->setDisabled(true);
-    bool res=builder.build(code, upload);
-    actions->setDisabled(false);
+    emit runningChanged(true);
+    forever
+    {
+        QString code;
+        Mode mode;
+        {
+            QMutexLocker locker(&mutex);
+            if (! pending)
+            {
+                running = false;
+                break;
+            }
+            code = this->code;
+            mode = this->mode;
+            builder.setSketchFile(fileName);
+            pending = false;
+            builder.setCanceled(false);
+        }
 
-    emit buildFinished(res);
+        if (mode == CheckMode)
+        {
+            bool res = builder.checkSyntax(code);
+            // a canceled check tells nothing about the code
+            if (! builder.isCanceled())
+                emit checkFinished(res, builder.diagnostics());
+            continue;
+        }
+
+        bool res = builder.build(code, mode == UploadMode);
+        if (mode == UploadMode)
+            emit uploadFinished(res);
+        else
+            emit buildFinished(res);
+    }
+    emit runningChanged(false);
 }
@@ -30,11 +30,21 @@ This program is free software; you can redistribute it and/or modify
 #define BUILDER_H
 
 #include <QScopedPointer>
+#include <QAtomicInt>
 #include <qxttemporarydir.h>
 
 #include "Board.h"
+#include "BuildCache.h"
+#include "BuildTrace.h"
+#include "Diagnostic.h"
+#include "DiagnosticParser.h"
+#include "SketchPreprocessor.h"
 #include "ILogger.h"
 
+class QSemaphore;
+class CompileJob;
+class PhaseTimer;
+
 /**
  * @brief Class to manage the compile process
  *
@@ -44,6 +54,7 @@ class Builder : public QObject
     Q_OBJECT
 public:
     Builder(QObject *parent = NULL);
+    ~Builder();
 
     /**
      * @brief Return board information to compile
@@ -94,6 +105,63 @@ public:
      */
     const QString uploadProtocol() const;
 
+    /**
+     * @brief Build for another board than the one selected in the settings
+     *
+     * @param board Board, as stored in the settings, e.g. "uno" or "mega,atmega1280,16000000L"
+     * @return void
+     */
+    void setBoard(const QString &board) { mBoard = board; }
+
+    /**
+     * @brief Upload to another device than the one selected in the settings
+     *
+     * @param device Device
+     * @return void
+     */
+    void setDevice(const QString &device) { mDevice = device; }
+
+    /**
+     * @brief Set the file the code to build comes from
+     *
+     * The other files of its folder are then part of the sketch: the .ino
+     * and .pde files are appended to the code, the .c, .cpp and .S files are
+     * compiled on their own and the headers can be included. They are read
+     * from the disk.
+     *
+     * @param fileName Main file of the sketch, or empty for a sketch without folder
+     * @return void
+     */
+    void setSketchFile(const QString &fileName) { mSketchFile = fileName; }
+
+    /**
+     * @brief Build with another profile than the one stored for the sketch
+     *
+     * @param profile Build profile, see Toolkit::buildProfiles()
+     * @return void
+     */
+    void setProfile(const QString &profile) { mProfile = profile; }
+
+    /**
+     * @brief Return the profile to build with
+     *
+     * By default, the profile stored in the settings for the sketch file.
+     *
+     * @return QString
+     */
+    QString profile() const;
+
+    /**
+     * @brief Return the location of the objects built with a profile
+     *
+     * Each profile has a namespace of its own in the cache, the default
+     * profile uses the main cache.
+     *
+     * @param profile Build profile
+     * @return QString
+     */
+    static QString cachePath(const QString &profile);
+
     /**
      * @brief Function that manage the build process
      *
@@ -103,31 +171,235 @@ public:
      */
     bool build(const QString &code, bool upload = false);
 
+    /**
+     * @brief Check the code for errors without building it
+     *
+     * The sketch is only parsed by the compiler, at a low priority: nothing
+     * is compiled, not even the core. The include paths of the libraries are
+     * kept as long as the sketch includes the same headers.
+     *
+     * @param code Source that will be checked
+     * @return bool, True if the code has no error or False if not
+     */
+    bool checkSyntax(const QString &code);
+
+    /**
+     * @brief Return the diagnostics of the last build or check
+     *
+     * @return const QList<Diagnostic>&
+     */
+    const QList<Diagnostic> &diagnostics() const { return mDiagnostics; }
+
+    /**
+     * @brief Cancel the build, or clear a previous cancellation
+     *
+     * Can be called from any thread. The running compilers are killed and the
+     * objects of the build are removed, but an upload is never interrupted.
+     * The flag stays set until it is cleared, so a build started after the
+     * cancellation is canceled too.
+     *
+     * @param canceled True to cancel, False to allow the next build to run
+     * @return void
+     */
+    void setCanceled(bool canceled);
+
+    /**
+     * @brief Return whether the build is canceled
+     *
+     * @return bool
+     */
+    bool isCanceled() const { return mCanceled != 0; }
+
+    /**
+     * @brief Return the timings of the last build
+     *
+     * @return const BuildTrace&
+     */
+    const BuildTrace &trace() const { return mTrace; }
+
+    /**
+     * @brief Save the trace of each build in a file
+     *
+     * By default, the trace is saved in the build cache when the build
+     * timings are enabled in the settings.
+     *
+     * @param fileName Trace file, in the Chrome trace event format
+     * @return void
+     */
+    void setTraceFileName(const QString &fileName) { mTraceFileName = fileName; }
+
+    /**
+     * @brief Share a build cache with other builders
+     *
+     * The units compiled by a builder are then reused by the others, even
+     * while their builds are running.
+     *
+     * @param cache Shared cache, or NULL to use the cache of the builder
+     * @return void
+     */
+    void setCache(BuildCache *cache);
+
+    /**
+     * @brief Share the compilers allowed to run with other builders
+     *
+     * Each compiler takes a token from the semaphore while it runs.
+     *
+     * @param tokens Shared tokens, or NULL for no limit but jobCount()
+     * @return void
+     */
+    void setJobTokens(QSemaphore *tokens) { mJobTokens = tokens; }
+
+    /**
+     * @brief Return the number of compilers allowed to run at the same time
+     *
+     * @return int
+     */
+    static int jobCount();
+
+    /**
+     * @brief Return the flash image written by the last successful build
+     *
+     * The file lives in the build directory, until the next build.
+     *
+     * @return const QString&, empty if the build failed
+     */
+    const QString &hexFileName() const { return mHexFileName; }
+
+    /**
+     * @brief Return the EEPROM image written by the last successful build
+     *
+     * @return const QString&, empty if the build failed
+     */
+    const QString &eepromFileName() const { return mEepromFileName; }
+
+    /**
+     * @brief Return the flash used by the last successful build
+     *
+     * @return quint32, in bytes
+     */
+    quint32 flashUsage() const { return mFlashUsage; }
+
+    /**
+     * @brief Return the RAM used by the global variables of the last successful build
+     *
+     * @return quint32, in bytes
+     */
+    quint32 ramUsage() const { return mRamUsage; }
+
 private:
     /**
-     * @brief Read all file of a path
+     * @brief Return the board to build for, as stored in the settings
+     *
+     * @return QString
+     */
+    QString boardSpec() const;
+
+    /**
+     * @brief Use the cache of a profile, unless a cache is shared
+     *
+     * @param profile Build profile
+     * @return void
+     */
+    void selectCache(const QString &profile);
+
+    /**
+     * @brief Build the sketch, see build()
+     *
+     * @param code Source that will be compiled
+     * @param upload True to realize the upload process or False to compile only
+     * @return bool, True if success or False if not
+     */
+    bool runBuild(const QString &code, bool upload);
+
+    /**
+     * @brief Report why the build failed, unless it was canceled
+     *
+     * @param message Error message
+     * @return bool, always False
+     */
+    bool fail(const QString &message);
+
+    /**
+     * @brief Write the sketch and the source generated from it
+     *
+     * The source is the preprocessed sketch, followed by main.cxx if the
+     * core has one.
+     *
+     * @param code Code of the sketch
+     * @param directory Build directory
+     * @return bool, True if success or False if not
+     */
+    bool writeSketch(const QString &code, const QString &directory);
+
+    /**
+     * @brief Return the files of the sketch folder, but the main file
      *
-     * @param filepath Path to files
-     * @return QString, Return file
+     * @return QStringList
      */
-    QString readAllFile(const QString& filepath);
+    QStringList sketchFiles() const;
+
+    /**
+     * @brief Return the headers included by the files of the sketch
+     *
+     * @param code Code of the main file
+     * @return QStringList
+     */
+    QStringList sketchIncludes(const QString &code) const;
+
+    /**
+     * @brief Record the end of a build phase
+     *
+     * @param name Phase name
+     * @param start Start of the phase, in the time of the trace
+     * @return void
+     */
+    void endPhase(const QString &name, qint64 start);
+
+    /**
+     * @brief Save the trace of the build, if enabled
+     *
+     * @return void
+     */
+    void saveTrace();
 
     /**
      * @brief Function to compile all dependencies
      *
+     * The libraries are resolved with the library index of the application.
+     *
      * @param objects List of objects
-     * @param code Source code
-     * @param includePaths Path of include files
+     * @param includes Headers included by the code
+     * @param corePaths Include paths of the core, used by every library
+     * @param includePaths Include paths of the sketch, the paths of the libraries are added
      * @param buildPath Build path
      * @param cflags C compiler flags
      * @param cxxflags C++ compiler flags
      * @param sflags S flags
      * @return bool, True if success or False if not
      */
-    bool compileDependencies(QStringList &objects, const QString& code, QStringList& includePaths, QString buildPath, const QStringList& cflags, const QStringList& cxxflags, const QStringList& sflags);
+    bool compileDependencies(QStringList &objects, const QStringList &includes, const QStringList &corePaths, QStringList& includePaths, QString buildPath, const QStringList& cflags, const QStringList& cxxflags, const QStringList& sflags);
+
+    /**
+     * @brief Add the paths of the libraries providing some headers, and of their dependencies
+     *
+     * @param includePaths Path of include files
+     * @param includes Headers included by the code
+     * @return void
+     */
+    void resolveIncludePaths(QStringList &includePaths, const QStringList &includes);
 
     /**
-     * @brief Manage the compile process of main code
+     * @brief Return the header of the core included before the sketch
+     *
+     * @return QString
+     */
+    static QString sketchHeader();
+
+    /**
+     * @brief Queue the compilation of sources
+     *
+     * Objects found in the build cache are reused, the other sources are
+     * queued and compiled by runCompileJobs().
      *
      * @param objects List of objects
      * @param sources Source code
@@ -140,6 +412,23 @@ private:
      */
     bool compile(QStringList &objects, const QStringList &sources, const QStringList &includePaths, const QStringList &cflags, const QStringList &cxxflags, const QStringList &sflags, const QString &outputDirectory = QString());
 
+    /**
+     * @brief Compile the queued sources in parallel
+     *
+     * The output of the compilers is logged in the order the sources were
+     * queued.
+     *
+     * @return bool, True if success or False if not
+     */
+    bool runCompileJobs();
+
+    /**
+     * @brief Release the units claimed by the queued jobs and delete them
+     *
+     * @return void
+     */
+    void discardJobs();
+
     /**
      * @brief Enumeration source type
      *
@@ -152,14 +441,27 @@ private:
         UnknownSource
     };
 
+    /**
+     * @brief Compute the key of the prebuilt core archive for the selected board
+     *
+     * The key identifies the board, mcu, frequency, SDK version, variant and
+     * compiler the core is built for.
+     *
+     * @param cflags C compiler flags
+     * @param sflags S compiler flags
+     * @return QByteArray, an empty key if the core can't be cached
+     */
+    QByteArray coreArchiveKey(const QStringList &cflags, const QStringList &sflags);
+
     /**
      * @brief Todo
      *
      * @param fileName Todo
      * @param objects Todo
+     * @param lto True if the objects are link-time optimized
      * @return bool
      */
-    bool archive(const QString &fileName, const QStringList &objects);
+    bool archive(const QString &fileName, const QStringList &objects, bool lto = false);
 
     /**
      * @brief Function to link objects
@@ -172,31 +474,27 @@ private:
     bool link(const QString &fileName, const QStringList &objects, const QStringList &ldflags);
 
     /**
-     * @brief Take size information of the compiled file
+     * @brief Report the memory used by the linked sketch
      *
-     * @param fileName Name of the file
-     * @param sizeflags flags for the command
-     * @return bool, Return True if sucess or if not False
-     */
-    bool size(const QString &fileName, const QStringList &sizeflags);
-
-    /**
-     * @brief Extract EEPROM code
+     * The usage is compared to the limits of the board, and the biggest
+     * objects and symbols are listed. The last builds of the sketch with
+     * the other profiles are compared to this one.
      *
-     * @param input Principal code
-     * @param output EEPROM part
-     * @return bool, Return True if sucess or if not False
+     * @param elfFileName Linked sketch
+     * @param mapFileName Map written by the linker
+     * @return bool, False if the sketch does not fit in the board
      */
-    bool extractEEPROM(const QString &input, const QString &output);
+    bool size(const QString &elfFileName, const QString &mapFileName);
 
     /**
-     * @brief Extract HEX
+     * @brief Extract the flash and EEPROM contents in Intel HEX format
      *
-     * @param input Principal code
-     * @param output Code in hexadecimal
+     * @param input Linked sketch
+     * @param hexOutput Flash contents
+     * @param eepromOutput EEPROM contents
      * @return bool, Return True if sucess or if not False
      */
-    bool extractHEX(const QString &input, const QString &output);
+    bool extractImages(const QString &input, const QString &hexOutput, const QString &eepromOutput);
 
     /**
      * @brief Upload the hexa to the board
@@ -217,31 +515,182 @@ private:
     /**
      * @brief Run a command
      *
+     * The output is logged while the command runs.
+     *
      * @param command Command
      * @param errorHighlighting Show error
      * @return int, Return the return of the command
      */
     int runCommand(const QStringList &command, bool errorHighlighting=false);
 
+    /**
+     * @brief Log the output of a command
+     *
+     * @param output Output of the command
+     * @param errorHighlighting Show error
+     * @return void
+     */
+    void logOutput(const QString &output, bool errorHighlighting);
+
     /**
      * @brief Build directory
      *
      */
     QScopedPointer<QxtTemporaryDir> mBuildDir;
 
+    /**
+     * @brief Objects compiled by previous builds
+     *
+     * mCache points to mOwnCache, the cache of the profile mOwnCacheProfile,
+     * unless a cache is shared with setCache().
+     */
+    QScopedPointer<BuildCache> mOwnCache;
+    QString mOwnCacheProfile;
+    BuildCache *mSharedCache;
+    BuildCache *mCache;
+
+    /**
+     * @brief Number of objects reused from the cache during the current build
+     *
+     */
+    int mCacheHits;
+
+    /**
+     * @brief Names of the objects of the current build, for the size report
+     *
+     */
+    QHash<QString, QString> mObjectNames;
+
+    /**
+     * @brief Compilations waiting for runCompileJobs()
+     *
+     */
+    QList<CompileJob *> mJobs;
+
+    /**
+     * @brief Set when a job failed, so the remaining jobs are skipped
+     *
+     */
+    QAtomicInt mAbortJobs;
+
+    /**
+     * @brief Set by setCanceled(), the running compilers are then killed
+     *
+     */
+    QAtomicInt mCanceled;
+
+    /**
+     * @brief Set once the upload started, the build is not canceled any more
+     *
+     */
+    bool mUploading;
+
+    /**
+     * @brief Set during syntax checks, to run the commands at a lower priority than the IDE
+     *
+     */
+    bool mLowPriority;
+
+    /**
+     * @brief Tokens shared with other builders, if any
+     *
+     */
+    QSemaphore *mJobTokens;
+
+    /**
+     * @brief Parser of the compiler output
+     *
+     */
+    DiagnosticParser mDiagnosticParser;
+
+    /**
+     * @brief Copy of the sketch in the build directory, and its number of lines
+     *
+     */
+    QString mSketchFileName;
+    int mSketchLines;
+
+    /**
+     * @brief Source generated from the sketch, and how its lines map to the sketch
+     *
+     */
+    QString mSourceFileName;
+    SketchPreprocessor mPreprocessor;
+
+    /**
+     * @brief Main file of the sketch, if known
+     *
+     */
+    QString mSketchFile;
+
+    /**
+     * @brief Diagnostics found by the current build
+     *
+     */
+    QList<Diagnostic> mDiagnostics;
+
+    /**
+     * @brief Include paths of the last check, and what they were resolved from
+     *
+     */
+    QStringList mCheckIncludes;
+    QString mCheckCorePath;
+    int mCheckRevision;
+    QStringList mCheckIncludePaths;
+
+    /**
+     * @brief Timings of the current build
+     *
+     */
+    BuildTrace mTrace;
+    QString mTraceFileName;
+
+    /**
+     * @brief Board and device overriding the settings, if not null
+     *
+     */
+    QString mBoard;
+    QString mDevice;
+
+    /**
+     * @brief Profile overriding the settings, if not null
+     *
+     */
+    QString mProfile;
+
+    /**
+     * @brief Memory used by the last successful build
+     *
+     */
+    quint32 mFlashUsage;
+    quint32 mRamUsage;
+
+    /**
+     * @brief Images written by the last build
+     *
+     */
+    QString mHexFileName;
+    QString mEepromFileName;
+
+    friend class PhaseTimer;
+
 signals:
     void logCommand(QStringList);
     void logImportant(QString);
     void logError(QString);
     void log(QString);
+    void diagnosticFound(Diagnostic);
+    void phaseFinished(QString, qint64);
 };
 
 #include <QThread>
-#include <QActionGroup>
+#include <QMutex>
 
 /**
  * @brief Class the realize the background compilation
  *
+ * Only the last requested build matters: a new request cancels the running
+ * build, and the new one starts as soon as the canceled one returned.
  */
 class BackgroundBuilder : public QThread
 {
@@ -249,39 +698,82 @@ class BackgroundBuilder : public QThread
 
 public:
     BackgroundBuilder(QObject *parent = NULL);
+    ~BackgroundBuilder();
 
     /**
-     * @brief Set actions
+     * @brief Realize the build process in background
+     *
+     * The running build, if any, is canceled in favor of this one.
      *
-     * @param actions Actions
+     * @param code Code
+     * @param upload If True the upload process will be performed
+     * @param fileName File the code comes from, see Builder::setSketchFile()
      * @return void
      */
-    void setRelatedActions(QActionGroup *actions);
+    void backgroundBuild(const QString &code, bool upload = false, const QString &fileName = QString());
 
     /**
-     * @brief Realize the build process in background
+     * @brief Check the code for errors in background, see Builder::checkSyntax()
+     *
+     * The running check, if any, is canceled in favor of this one.
      *
      * @param code Code
-     * @param upload If True the upload process will be performed
+     * @param fileName File the code comes from, see Builder::setSketchFile()
      * @return void
      */
-    void backgroundBuild(const QString &code, bool upload = false);
+    void backgroundCheck(const QString &code, const QString &fileName = QString());
 
     /**
      * @brief Start the build process
      *
+     * Runs the requested builds until none is pending.
+     *
      * @return void
      */
     void run();
 
+public slots:
+    /**
+     * @brief Cancel the running build and forget the pending one
+     *
+     * @return void
+     */
+    void cancel();
+
 signals:
     void buildFinished(bool ok);
+    void uploadFinished(bool ok);
+    void checkFinished(bool ok, QList<Diagnostic> diagnostics);
+    void runningChanged(bool running);
     void logCommand(QStringList);
     void logImportant(QString);
     void logError(QString);
     void log(QString);
+    void diagnosticFound(Diagnostic);
+    void phaseFinished(QString, qint64);
 
 private:
+    /**
+     * @brief Kind of request
+     *
+     */
+    enum Mode
+    {
+        BuildMode,
+        UploadMode,
+        CheckMode
+    };
+
+    /**
+     * @brief Queue a request, canceling the running one
+     *
+     * @param code Code
+     * @param fileName File the code comes from
+     * @param mode Kind of request
+     * @return void
+     */
+    void request(const QString &code, const QString &fileName, Mode mode);
+
     /**
      * @brief Perform the build process
      *
@@ -289,10 +781,22 @@ private:
     Builder builder;
 
     /**
-     * @brief Actions
+     * @brief Protects the request and the running flag
+     *
+     */
+    QMutex mutex;
+
+    /**
+     * @brief True when a request waits for run()
+     *
+     */
+    bool pending;
+
+    /**
+     * @brief True from start() until run() found no pending request
      *
      */
-    QActionGroup *actions;
+    bool running;
 
     /**
      * @brief Main code
@@ -301,10 +805,16 @@ private:
     QString code;
 
     /**
-     * @brief True to start upload process
+     * @brief File the code comes from
+     *
+     */
+    QString fileName;
+
+    /**
+     * @brief What to do with the code
      *
      */
-    bool upload;
+    Mode mode;
 
 };
 
@@ -0,0 +1,469 @@
+/*
+  CommandLine.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file CommandLine.cpp
+ * \author Denis Martinez
+ */
+
+#include "CommandLine.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "IDEApplication.h"
+
+#include "Board.h"
+#include "Builder.h"
+#include "BatchBuilder.h"
+#include "Toolkit.h"
+#include "Benchmark.h"
+#include "utils/Json.h"
+
+CommandLine::CommandLine(QObject *parent)
+    : QObject(parent),
+      mOut(stdout),
+      mStubToolchain(false),
+      mUpload(false),
+      mHelp(false),
+      mBatch(false),
+      mBatchBuilder(NULL)
+{
+    mOut.setCodec("UTF-8");
+}
+
+CommandLine::~CommandLine()
+{
+}
+
+bool CommandLine::isRequested(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--build") == 0 || strcmp(argv[i], "--upload") == 0
+            || strcmp(argv[i], "--sketchbook") == 0 || strcmp(argv[i], "--benchmark") == 0
+            || strcmp(argv[i], "--help") == 0)
+            return true;
+    }
+    return false;
+}
+
+bool CommandLine::parse(const QStringList &arguments)
+{
+    for (int i = 1; i < arguments.size(); i++)
+    {
+        const QString &argument = arguments.at(i);
+        if (argument == "--help" || argument == "-h")
+        {
+            mHelp = true;
+            continue;
+        }
+        if (argument == "--stub-toolchain")
+        {
+            mStubToolchain = true;
+            continue;
+        }
+
+        // every other option takes a value
+        if (i + 1 >= arguments.size())
+        {
+            writeLog("error", tr("Missing value for %0.").arg(argument));
+            return false;
+        }
+        QString value = arguments.at(++i);
+
+        if (argument == "--build")
+            mSketches << value;
+        else if (argument == "--upload")
+        {
+            mSketches << value;
+            mUpload = true;
+        }
+        else if (argument == "--sketchbook")
+        {
+            mSketches << BatchBuilder::sketchbookFiles(value);
+            mBatch = true;
+        }
+        else if (argument == "--board")
+            mBoards << value;
+        else if (argument == "--profile")
+            mProfiles << value;
+        else if (argument == "--benchmark")
+            mBenchmarkDirectory = value;
+        else if (argument == "--port")
+            mPort = value;
+        else if (argument == "--output")
+            mOutputDirectory = value;
+        else if (argument == "--trace")
+            mTraceFileName = value;
+        else
+        {
+            writeLog("error", tr("Unknown option %0.").arg(argument));
+            return false;
+        }
+    }
+
+    if (! mBoards.isEmpty())
+        mBoard = mBoards.last();
+    if (mBoards.size() > 1 && mBenchmarkDirectory.isEmpty())
+    {
+        writeLog("error", tr("Only the benchmark can use several boards."));
+        return false;
+    }
+    if (mSketches.size() > 1)
+        mBatch = true;
+    if (mUpload && mBatch)
+    {
+        writeLog("error", tr("Only one sketch can be uploaded at a time."));
+        return false;
+    }
+    if (mProfiles.size() > 1 && (mUpload || mBatch))
+    {
+        writeLog("error", tr("Only a single sketch can be built with several profiles."));
+        return false;
+    }
+    foreach (const QString &profile, mProfiles)
+    {
+        if (! Toolkit::buildProfiles().contains(profile))
+        {
+            writeLog("error", tr("Unknown build profile %0, the known profiles are: %1.").arg(profile, Toolkit::buildProfiles().join(", ")));
+            return false;
+        }
+    }
+    return true;
+}
+
+void CommandLine::usage()
+{
+    mOut << tr("Usage: %0 --build SKETCH [--build SKETCH...] [options]\n"
+               "       %0 --sketchbook DIR [options]\n"
+               "       %0 --upload SKETCH --port DEVICE [options]\n"
+               "       %0 --benchmark DIR [--board BOARD...] [--stub-toolchain]\n"
+               "\n"
+               "Build or upload sketches without the graphical interface. The progress\n"
+               "is printed as JSON, one object per line. Several sketches are built in\n"
+               "parallel, compiling the core and the libraries they share only once.\n"
+               "\n"
+               "Options:\n"
+               "  --sketchbook DIR  build every sketch found in DIR\n"
+               "  --board BOARD     board to build for, e.g. uno or mega,atmega1280\n"
+               "                    (default: the board selected in the IDE)\n"
+               "  --profile NAME    build profile: size, speed, lto or debug (default: the one\n"
+               "                    of the sketch); give several to compare their memory usage\n"
+               "  --port DEVICE     serial port of the board (default: the one selected in the IDE)\n"
+               "  --output DIR      copy the HEX and EEPROM images to DIR\n"
+               "  --trace FILE      save the timings of the build as a Chrome trace\n"
+               "  --benchmark DIR   build the examples cold, warm and after an edit, and\n"
+               "                    write the timings to DIR/benchmark.json and .csv\n"
+               "  --stub-toolchain  benchmark with a fake toolchain, to only measure the IDE\n"
+               "  --help            print this help\n").arg(QFileInfo(qApp->applicationFilePath()).fileName());
+    mOut.flush();
+}
+
+int CommandLine::exec(const QStringList &arguments)
+{
+    if (! parse(arguments))
+        return 2;
+    if (mHelp || (mSketches.isEmpty() && mBenchmarkDirectory.isEmpty()))
+    {
+        usage();
+        return mHelp ? 0 : 2;
+    }
+
+    if (! ideApp->settings()->isCorrect())
+    {
+        writeLog("error", tr("The Arduino SDK or sketchbook path is not configured, run the IDE once to set it up."));
+        return 2;
+    }
+
+    foreach (const QString &board, mBoards)
+    {
+        QString id = board.split(",").first();
+        if (! Board::boardIds().contains(id))
+        {
+            writeLog("error", tr("Unknown board %0, the known boards are: %1.").arg(id, Board::boardIds().join(", ")));
+            return 2;
+        }
+    }
+
+    bool success;
+    if (! mBenchmarkDirectory.isEmpty())
+        success = benchmark();
+    else
+        success = mBatch ? buildSketches() : buildSketch();
+    return success ? 0 : 1;
+}
+
+bool CommandLine::buildSketch()
+{
+    const QString &sketch = mSketches.first();
+    QFile file(sketch);
+    if (! file.open(QIODevice::ReadOnly))
+    {
+        writeLog("error", tr("Cannot read %0: %1").arg(sketch, file.errorString()));
+        return false;
+    }
+    QString code = QString::fromLocal8Bit(file.readAll());
+    file.close();
+
+    // the builder runs in this thread, the signals are delivered directly
+    Builder builder;
+    connectBuilder(&builder, sketch);
+    builder.setSketchFile(sketch);
+    if (! mBoard.isEmpty())
+        builder.setBoard(mBoard);
+    if (! mPort.isEmpty())
+        builder.setDevice(mPort);
+    if (! mTraceFileName.isEmpty())
+        builder.setTraceFileName(mTraceFileName);
+
+    // each build reports how it compares to the previous profiles
+    if (mProfiles.isEmpty())
+        return finishSketch(&builder, builder.build(code, mUpload));
+
+    bool success = true;
+    foreach (const QString &profile, mProfiles)
+    {
+        builder.setProfile(profile);
+        if (! finishSketch(&builder, builder.build(code, mUpload)))
+            success = false;
+    }
+    return success;
+}
+
+bool CommandLine::buildSketches()
+{
+    BatchBuilder batch;
+    mBatchBuilder = &batch;
+    connect(&batch, SIGNAL(sketchFinished(int, bool)), this, SLOT(sketchFinished(int, bool)));
+
+    bool success = true;
+    foreach (const QString &sketch, mSketches)
+    {
+        if (! batch.addSketch(sketch))
+        {
+            writeLog("error", tr("Cannot read %0.").arg(sketch));
+            success = false;
+        }
+    }
+    for (int i = 0; i < batch.sketches().size(); i++)
+        connectBuilder(batch.builder(i), batch.sketches().at(i));
+    if (! mBoard.isEmpty())
+        batch.setBoard(mBoard);
+    if (! mProfiles.isEmpty())
+        batch.setProfile(mProfiles.first());
+    if (! mTraceFileName.isEmpty())
+        batch.setTraceFileName(mTraceFileName);
+
+    int failures = batch.build();
+    mBatchBuilder = NULL;
+
+    QByteArray summary = beginEvent("summary");
+    summary += ",\"built\":" + QByteArray::number(batch.sketches().size() - failures);
+    summary += ",\"failed\":" + QByteArray::number(failures) + '}';
+    writeEvent(summary);
+
+    return success && failures == 0;
+}
+
+bool CommandLine::benchmark()
+{
+    Benchmark benchmark;
+    connect(&benchmark, SIGNAL(sketchBuilt(QString, QString, QString, bool, qint64)),
+            this, SLOT(benchmarkBuilt(QString, QString, QString, bool, qint64)));
+
+    QStringList boards = mBoards;
+    if (boards.isEmpty())
+        boards << ideApp->settings()->board();
+    benchmark.setBoards(boards);
+    benchmark.setStubToolchain(mStubToolchain);
+
+    if (! benchmark.run(mBenchmarkDirectory))
+    {
+        writeLog("error", tr("Cannot write the benchmark results to %0.").arg(mBenchmarkDirectory));
+        return false;
+    }
+    writeLog("important", tr("Benchmark results written to %0.").arg(QDir(mBenchmarkDirectory).absolutePath()));
+    return true;
+}
+
+void CommandLine::connectBuilder(Builder *builder, const QString &sketch)
+{
+    mBuilderSketches.insert(builder, QFileInfo(sketch).absoluteFilePath());
+
+    connect(builder, SIGNAL(log(QString)), this, SLOT(log(QString)));
+    connect(builder, SIGNAL(logImportant(QString)), this, SLOT(logImportant(QString)));
+    connect(builder, SIGNAL(logError(QString)), this, SLOT(logError(QString)));
+    connect(builder, SIGNAL(logCommand(QStringList)), this, SLOT(logCommand(QStringList)));
+    connect(builder, SIGNAL(diagnosticFound(Diagnostic)), this, SLOT(logDiagnostic(Diagnostic)));
+    connect(builder, SIGNAL(phaseFinished(QString, qint64)), this, SLOT(logPhase(QString, qint64)));
+}
+
+bool CommandLine::finishSketch(Builder *builder, bool success)
+{
+    QString sketch = mBuilderSketches.value(builder);
+    QString hexFileName;
+    QString eepromFileName;
+
+    // the images are written in a temporary directory, only report them
+    // once copied
+    if (success && ! mOutputDirectory.isEmpty())
+    {
+        QDir output(mOutputDirectory);
+        QString baseName = QFileInfo(sketch).completeBaseName();
+        if (mProfiles.size() > 1)
+            baseName += "-" + builder->profile();
+        hexFileName = QFileInfo(output.filePath(baseName + ".hex")).absoluteFilePath();
+        eepromFileName = QFileInfo(output.filePath(baseName + ".eep")).absoluteFilePath();
+        QFile::remove(hexFileName);
+        QFile::remove(eepromFileName);
+        if (! QDir().mkpath(output.path()) || ! QFile::copy(builder->hexFileName(), hexFileName)
+            || ! QFile::copy(builder->eepromFileName(), eepromFileName))
+        {
+            writeLog("error", tr("Cannot copy the images of %0 to %1.").arg(QFileInfo(sketch).fileName(), mOutputDirectory));
+            success = false;
+        }
+    }
+
+    QByteArray result = "{\"type\":\"result\",\"sketch\":" + Json::quote(sketch)
+        + ",\"board\":" + Json::quote(builder->name())
+        + ",\"profile\":" + Json::quote(builder->profile())
+        + ",\"upload\":" + (mUpload ? "true" : "false")
+        + ",\"success\":" + (success ? "true" : "false");
+    if (success)
+    {
+        result += ",\"flash\":" + QByteArray::number(builder->flashUsage());
+        result += ",\"ram\":" + QByteArray::number(builder->ramUsage());
+    }
+    if (success && ! hexFileName.isEmpty())
+        result += ",\"hex\":" + Json::quote(hexFileName) + ",\"eeprom\":" + Json::quote(eepromFileName);
+    result += '}';
+    writeEvent(result);
+
+    return success;
+}
+
+QByteArray CommandLine::beginEvent(const char *type)
+{
+    QByteArray object = QByteArray("{\"type\":\"") + type + '"';
+    QHash<QObject *, QString>::const_iterator it = mBuilderSketches.constFind(sender());
+    if (it != mBuilderSketches.constEnd())
+        object += ",\"sketch\":" + Json::quote(*it);
+    return object;
+}
+
+void CommandLine::writeEvent(const QByteArray &object)
+{
+    // flush each line, the output is usually read by another program while
+    // the build runs
+    fwrite(object.constData(), 1, object.size(), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+void CommandLine::writeLog(const char *level, const QString &text)
+{
+    QByteArray prefix = beginEvent("log") + ",\"level\":\"" + level + "\",\"text\":";
+    foreach (const QString &line, text.split('\n'))
+        writeEvent(prefix + Json::quote(line) + '}');
+}
+
+void CommandLine::log(const QString &text)
+{
+    writeLog("info", text);
+}
+
+void CommandLine::logImportant(const QString &text)
+{
+    writeLog("important", text);
+}
+
+void CommandLine::logError(const QString &text)
+{
+    writeLog("error", text);
+}
+
+void CommandLine::logCommand(const QStringList &command)
+{
+    QByteArray object = beginEvent("command") + ",\"argv\":[";
+    for (int i = 0; i < command.size(); i++)
+    {
+        if (i > 0)
+            object += ',';
+        object += Json::quote(command.at(i));
+    }
+    object += "]}";
+    writeEvent(object);
+}
+
+void CommandLine::logDiagnostic(const Diagnostic &diagnostic)
+{
+    static const char *severities[] = { "error", "warning", "note" };
+
+    // report the locations in the sketch against the file given on the
+    // command line, not the copy in the build directory
+    QString fileName = diagnostic.inSketch ? mBuilderSketches.value(sender()) : diagnostic.fileName;
+
+    QByteArray object = beginEvent("diagnostic");
+    object += ",\"severity\":\"";
+    object += severities[diagnostic.severity];
+    object += "\",\"file\":" + Json::quote(fileName);
+    object += ",\"line\":" + QByteArray::number(diagnostic.line);
+    object += ",\"column\":" + QByteArray::number(diagnostic.column);
+    object += ",\"message\":" + Json::quote(diagnostic.message);
+    object += ",\"includedFrom\":[";
+    for (int i = 0; i < diagnostic.includeChain.size(); i++)
+    {
+        if (i > 0)
+            object += ',';
+        object += Json::quote(diagnostic.includeChain.at(i));
+    }
+    object += "]}";
+    writeEvent(object);
+}
+
+void CommandLine::logPhase(const QString &phase, qint64 msecs)
+{
+    writeEvent(beginEvent("phase") + ",\"name\":" + Json::quote(phase) + ",\"msecs\":" + QByteArray::number(msecs) + '}');
+}
+
+void CommandLine::sketchFinished(int index, bool success)
+{
+    if (mBatchBuilder != NULL)
+        finishSketch(mBatchBuilder->builder(index), success);
+}
+
+void CommandLine::benchmarkBuilt(const QString &board, const QString &sketch, const QString &scenario, bool success, qint64 msecs)
+{
+    QByteArray object = beginEvent("benchmark");
+    object += ",\"board\":" + Json::quote(board);
+    object += ",\"sketch\":" + Json::quote(sketch);
+    object += ",\"scenario\":" + Json::quote(scenario);
+    object += QByteArray(",\"success\":") + (success ? "true" : "false");
+    object += ",\"msecs\":" + QByteArray::number(msecs) + '}';
+    writeEvent(object);
+}
@@ -0,0 +1,187 @@
+/*
+  CommandLine.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file CommandLine.h
+ * \author Denis Martinez
+ */
+
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <QObject>
+#include <QStringList>
+#include <QTextStream>
+#include <QHash>
+
+#include "Diagnostic.h"
+
+class Builder;
+class BatchBuilder;
+
+/**
+ * @brief Build or upload sketches without the GUI
+ *
+ * A single sketch is built in the main thread, several sketches are built
+ * in parallel by a BatchBuilder. Everything the builders report is printed
+ * on the standard output as JSON, one object per line, e.g.
+ * {"type":"log","sketch":"/path/Blink.ino","level":"error","text":"Link failed."}.
+ */
+class CommandLine : public QObject
+{
+    Q_OBJECT
+
+public:
+    CommandLine(QObject *parent = NULL);
+    ~CommandLine();
+
+    /**
+     * @brief Check whether the arguments ask for a build without the GUI
+     *
+     * Called before the application is created, to know if a display is needed.
+     *
+     * @param argc Number of arguments
+     * @param argv Arguments
+     * @return bool
+     */
+    static bool isRequested(int argc, char **argv);
+
+    /**
+     * @brief Run the command given by the arguments
+     *
+     * @param arguments Arguments of the application
+     * @return int, the exit code: 0 on success, 1 if a build failed, 2 on usage errors
+     */
+    int exec(const QStringList &arguments);
+
+private:
+    /**
+     * @brief Parse the arguments
+     *
+     * @param arguments Arguments of the application
+     * @return bool, True if success or False if not
+     */
+    bool parse(const QStringList &arguments);
+
+    /**
+     * @brief Print the usage on the standard output
+     *
+     * @return void
+     */
+    void usage();
+
+    /**
+     * @brief Build the only sketch, or upload it
+     *
+     * @return bool, True if success or False if not
+     */
+    bool buildSketch();
+
+    /**
+     * @brief Build all the sketches in parallel
+     *
+     * @return bool, True if all of them were built or False if not
+     */
+    bool buildSketches();
+
+    /**
+     * @brief Build the examples for the boards and write the timings
+     *
+     * @return bool, True if success or False if not
+     */
+    bool benchmark();
+
+    /**
+     * @brief Print the events of a builder, tagged with its sketch
+     *
+     * @param builder Builder
+     * @param sketch Sketch built by the builder
+     * @return void
+     */
+    void connectBuilder(Builder *builder, const QString &sketch);
+
+    /**
+     * @brief Copy the images of a sketch to the output directory and print the result
+     *
+     * @param builder Builder of the sketch
+     * @param success True if the build succeeded
+     * @return bool, False if the build or the copy failed
+     */
+    bool finishSketch(Builder *builder, bool success);
+
+    /**
+     * @brief Start a JSON event
+     *
+     * The event is tagged with the sketch of the builder sending the signal
+     * being handled, if any.
+     *
+     * @param type Event type
+     * @return QByteArray, the unterminated JSON object
+     */
+    QByteArray beginEvent(const char *type);
+
+    /**
+     * @brief Print a JSON object on its own line
+     *
+     * @param object JSON object
+     * @return void
+     */
+    void writeEvent(const QByteArray &object);
+
+    /**
+     * @brief Print a message
+     *
+     * @param level "info", "important" or "error"
+     * @param text Text, printed as one event per line
+     * @return void
+     */
+    void writeLog(const char *level, const QString &text);
+
+    QTextStream mOut;
+    QStringList mSketches;
+    QStringList mBoards;
+    QStringList mProfiles;
+    QString mBoard;
+    QString mPort;
+    QString mOutputDirectory;
+    QString mTraceFileName;
+    QString mBenchmarkDirectory;
+    bool mStubToolchain;
+    bool mUpload;
+    bool mHelp;
+    bool mBatch;
+    QHash<QObject *, QString> mBuilderSketches;
+    BatchBuilder *mBatchBuilder;
+
+private slots:
+    void log(const QString &text);
+    void logImportant(const QString &text);
+    void logError(const QString &text);
+    void logCommand(const QStringList &command);
+    void logDiagnostic(const Diagnostic &diagnostic);
+    void logPhase(const QString &phase, qint64 msecs);
+    void sketchFinished(int index, bool success);
+    void benchmarkBuilt(const QString &board, const QString &sketch, const QString &scenario, bool success, qint64 msecs);
+};
+
+#endif // COMMANDLINE_H
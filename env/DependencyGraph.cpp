@@ -0,0 +1,313 @@
+/*
+  DependencyGraph.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file DependencyGraph.cpp
+ * \author Denis Martinez
+ */
+
+#include "DependencyGraph.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QDebug>
+
+// "ADG" followed by the format version
+static const quint32 dependencyGraphMagic = 0x41444701;
+
+// units not built for this long are forgotten
+static const uint lifetime = 30 * 24 * 3600;
+
+DependencyGraph::DependencyGraph(const QString &fileName)
+    : mFileName(fileName),
+      mLoaded(false),
+      mModified(false)
+{
+}
+
+bool DependencyGraph::load()
+{
+    if (mLoaded)
+        return true;
+    mLoaded = true;
+
+    QFile file(mFileName);
+    if (! file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_6);
+    quint32 magic;
+    in >> magic;
+    if (magic != dependencyGraphMagic)
+        return false;
+
+    quint32 count;
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++)
+    {
+        QByteArray key;
+        Unit unit;
+        in >> key >> unit.dependencies >> unit.lastUsed;
+        mUnits.insert(key, unit);
+    }
+
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++)
+    {
+        QString fileName;
+        FileState state;
+        in >> fileName >> state.size >> state.modified >> state.digest;
+        mFiles.insert(fileName, state);
+    }
+
+    if (in.status() != QDataStream::Ok)
+    {
+        qWarning() << "DependencyGraph: ignoring corrupted file" << mFileName;
+        mUnits.clear();
+        mFiles.clear();
+        return false;
+    }
+    return true;
+}
+
+bool DependencyGraph::save()
+{
+    if (! mModified)
+        return true;
+
+    // forget the units nobody built for a long time, and the headers they
+    // were the only ones to use
+    uint now = QDateTime::currentDateTime().toTime_t();
+    QSet<QString> used;
+    QHash<QByteArray, Unit>::iterator it = mUnits.begin();
+    while (it != mUnits.end())
+    {
+        if (it->lastUsed + lifetime < now)
+            it = mUnits.erase(it);
+        else
+        {
+            foreach (const QString &dependency, it->dependencies)
+                used.insert(dependency);
+            ++it;
+        }
+    }
+    QHash<QString, FileState>::iterator fit = mFiles.begin();
+    while (fit != mFiles.end())
+    {
+        if (used.contains(fit.key()))
+            ++fit;
+        else
+            fit = mFiles.erase(fit);
+    }
+
+    if (! QDir().mkpath(QFileInfo(mFileName).path()))
+        return false;
+
+    QString temporary = mFileName + ".tmp";
+    QFile file(temporary);
+    if (! file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_6);
+    out << dependencyGraphMagic;
+    out << quint32(mUnits.size());
+    for (it = mUnits.begin(); it != mUnits.end(); ++it)
+        out << it.key() << it->dependencies << it->lastUsed;
+    out << quint32(mFiles.size());
+    for (fit = mFiles.begin(); fit != mFiles.end(); ++fit)
+        out << fit.key() << fit->size << fit->modified << fit->digest;
+    file.close();
+
+    if (out.status() != QDataStream::Ok)
+        return false;
+
+    QFile::remove(mFileName);
+    if (! QFile::rename(temporary, mFileName))
+        return false;
+
+    mModified = false;
+    return true;
+}
+
+uint DependencyGraph::unitLifetime()
+{
+    return lifetime;
+}
+
+void DependencyGraph::beginBuild()
+{
+    load();
+    mChecked.clear();
+}
+
+bool DependencyGraph::record(const QByteArray &unit, const QString &depFileName)
+{
+    QFile file(depFileName);
+    if (! file.open(QIODevice::ReadOnly))
+        return false;
+
+    Unit u;
+    foreach (const QString &dependency, parseDepFile(file.readAll()))
+    {
+        QString path = QFileInfo(dependency).absoluteFilePath();
+        u.dependencies << path;
+        fileDigest(path);
+    }
+    u.lastUsed = QDateTime::currentDateTime().toTime_t();
+
+    mUnits.insert(unit, u);
+    mModified = true;
+    return true;
+}
+
+QByteArray DependencyGraph::dependencyDigest(const QByteArray &unit)
+{
+    QHash<QByteArray, Unit>::iterator it = mUnits.find(unit);
+    if (it == mUnits.end())
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    foreach (const QString &dependency, it->dependencies)
+    {
+        hash.addData(dependency.toUtf8());
+        hash.addData(fileDigest(dependency));
+    }
+
+    // only refresh the timestamp once a day, to avoid saving after each build
+    uint now = QDateTime::currentDateTime().toTime_t();
+    if (it->lastUsed + 24 * 3600 < now)
+    {
+        it->lastUsed = now;
+        mModified = true;
+    }
+
+    return hash.result();
+}
+
+QByteArray DependencyGraph::fileDigest(const QString &fileName)
+{
+    QHash<QString, FileState>::const_iterator it = mFiles.constFind(fileName);
+    if (it != mFiles.constEnd() && mChecked.contains(fileName))
+        return it->digest;
+    mChecked.insert(fileName);
+
+    FileState state;
+    state.size = -1;
+    state.modified = 0;
+    state.digest = "missing";
+
+    QFileInfo info(fileName);
+    if (info.isFile())
+    {
+        state.size = info.size();
+        state.modified = info.lastModified().toTime_t();
+        if (it != mFiles.constEnd() && it->size == state.size && it->modified == state.modified)
+            return it->digest;
+
+        QFile file(fileName);
+        if (file.open(QIODevice::ReadOnly))
+            state.digest = QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha1);
+    }
+
+    if (it == mFiles.constEnd() || it->digest != state.digest || it->size != state.size || it->modified != state.modified)
+    {
+        mFiles.insert(fileName, state);
+        mModified = true;
+    }
+    return state.digest;
+}
+
+QStringList DependencyGraph::parseDepFile(const QByteArray &contents)
+{
+    // the rule looks like "target.o: source.cpp header1.h \
+    //   header2.h", the target ends at the first colon followed by a blank,
+    // which leaves Windows drive letters alone
+    int start = -1;
+    for (int i = 0; i < contents.size(); i++)
+    {
+        if (contents.at(i) == ':' && (i + 1 == contents.size() || contents.at(i + 1) == ' ' || contents.at(i + 1) == '\t'
+                                      || contents.at(i + 1) == '\n' || contents.at(i + 1) == '\r' || contents.at(i + 1) == '\\'))
+        {
+            start = i + 1;
+            break;
+        }
+    }
+    if (start < 0)
+        return QStringList();
+
+    QStringList prerequisites;
+    QByteArray word;
+    for (int i = start; i < contents.size(); i++)
+    {
+        char c = contents.at(i);
+        char next = i + 1 < contents.size() ? contents.at(i + 1) : '\0';
+
+        if (c == '\\' && (next == '\n' || next == '\r'))
+        {
+            // line continuation
+            i++;
+            if (next == '\r' && i + 1 < contents.size() && contents.at(i + 1) == '\n')
+                i++;
+            c = ' ';
+        }
+        else if (c == '\\' && (next == ' ' || next == '#'))
+        {
+            word += next;
+            i++;
+            continue;
+        }
+        else if (c == '$' && next == '$')
+        {
+            word += '$';
+            i++;
+            continue;
+        }
+
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+        {
+            if (! word.isEmpty())
+            {
+                prerequisites << QString::fromLocal8Bit(word);
+                word.clear();
+            }
+            // an unescaped end of line closes the rule
+            if (c == '\n')
+                break;
+        }
+        else
+            word += c;
+    }
+    if (! word.isEmpty())
+        prerequisites << QString::fromLocal8Bit(word);
+
+    // the source itself always comes first
+    if (! prerequisites.isEmpty())
+        prerequisites.removeFirst();
+    return prerequisites;
+}
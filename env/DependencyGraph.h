@@ -0,0 +1,140 @@
+/*
+  DependencyGraph.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file DependencyGraph.h
+ * \author Denis Martinez
+ */
+
+#ifndef DEPENDENCYGRAPH_H
+#define DEPENDENCYGRAPH_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+
+/**
+ * @brief Headers included by each translation unit, kept between sessions
+ *
+ * The graph is filled from the .d files written by the compiler (-MMD) and
+ * remembers the size, modification time and digest of every header, so a
+ * header is only read again when it was touched.
+ */
+class DependencyGraph
+{
+public:
+    /**
+     * @brief Create a graph saved in a file
+     *
+     * @param fileName File the graph is loaded from and saved to
+     */
+    explicit DependencyGraph(const QString &fileName);
+
+    /**
+     * @brief Load the graph saved by a previous session
+     *
+     * @return bool, True if success or False if not
+     */
+    bool load();
+
+    /**
+     * @brief Save the graph if it changed
+     *
+     * @return bool, True if success or False if not
+     */
+    bool save();
+
+    /**
+     * @brief Forget the headers checked during the previous build
+     *
+     * @return void
+     */
+    void beginBuild();
+
+    /**
+     * @brief Record the headers of a translation unit from its .d file
+     *
+     * @param unit Key of the translation unit
+     * @param depFileName .d file written by the compiler
+     * @return bool, True if success or False if not
+     */
+    bool record(const QByteArray &unit, const QString &depFileName);
+
+    /**
+     * @brief Digest of the current contents of the headers of a translation unit
+     *
+     * @param unit Key of the translation unit
+     * @return QByteArray, empty if the headers of the unit are unknown
+     */
+    QByteArray dependencyDigest(const QByteArray &unit);
+
+    /**
+     * @brief Extract the prerequisites from the contents of a .d file
+     *
+     * The first prerequisite, the source itself, is skipped.
+     *
+     * @param contents Contents of the .d file
+     * @return QStringList
+     */
+    static QStringList parseDepFile(const QByteArray &contents);
+
+    /**
+     * @brief Return how long a unit is kept without being built
+     *
+     * @return uint, in seconds
+     */
+    static uint unitLifetime();
+
+private:
+    struct FileState
+    {
+        qint64 size;
+        uint modified;
+        QByteArray digest;
+    };
+
+    struct Unit
+    {
+        QStringList dependencies;
+        uint lastUsed;
+    };
+
+    /**
+     * @brief Return the digest of a file, reading it only if it changed
+     *
+     * @param fileName File name
+     * @return QByteArray
+     */
+    QByteArray fileDigest(const QString &fileName);
+
+    QString mFileName;
+    bool mLoaded;
+    bool mModified;
+    QHash<QString, FileState> mFiles;
+    QHash<QByteArray, Unit> mUnits;
+    QSet<QString> mChecked;
+};
+
+#endif // DEPENDENCYGRAPH_H
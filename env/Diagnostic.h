@@ -0,0 +1,100 @@
+/*
+  Diagnostic.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file Diagnostic.h
+ * \author Denis Martinez
+ */
+
+#ifndef DIAGNOSTIC_H
+#define DIAGNOSTIC_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QMetaType>
+
+/**
+ * @brief Error, warning or note reported by the compiler
+ *
+ */
+struct Diagnostic
+{
+    /**
+     * @brief Severity of a diagnostic
+     *
+     */
+    enum Severity
+    {
+        Error,
+        Warning,
+        Note
+    };
+
+    Diagnostic()
+        : line(0),
+          column(0),
+          severity(Error),
+          inSketch(false)
+    {
+    }
+
+    /**
+     * @brief File as reported by the compiler
+     *
+     */
+    QString fileName;
+
+    /**
+     * @brief Line, starting from 1
+     *
+     */
+    int line;
+
+    /**
+     * @brief Column, starting from 1, or 0 if unknown
+     *
+     */
+    int column;
+
+    Severity severity;
+    QString message;
+
+    /**
+     * @brief Locations of the #include directives leading to the file, innermost first
+     *
+     */
+    QStringList includeChain;
+
+    /**
+     * @brief True if the location is in the code of the sketch being built
+     *
+     * The line is then a line of the sketch, not of the generated source.
+     */
+    bool inSketch;
+};
+
+Q_DECLARE_METATYPE(Diagnostic)
+Q_DECLARE_METATYPE(QList<Diagnostic>)
+
+#endif // DIAGNOSTIC_H
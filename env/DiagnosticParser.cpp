@@ -0,0 +1,78 @@
+/*
+  DiagnosticParser.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file DiagnosticParser.cpp
+ * \author Denis Martinez
+ */
+
+#include "DiagnosticParser.h"
+
+DiagnosticParser::DiagnosticParser()
+    : mDiagnosticPattern("^(.+):(\\d+):(?:(\\d+):)? (fatal error|error|warning|note): (.*)$"),
+      mIncludedFromPattern("^(?:In file included|\\s+) from (.+):(\\d+)(?::\\d+)?[,:]$"),
+      mInIncludeChain(false)
+{
+}
+
+bool DiagnosticParser::parseLine(const QString &line, Diagnostic &diagnostic)
+{
+    // "In file included from a.h:3:0,", then "                 from b.cpp:1:"
+    if ((line.startsWith("In file included from ") || (mInIncludeChain && line.startsWith(' ')))
+            && mIncludedFromPattern.indexIn(line) != -1)
+    {
+        if (line.startsWith("In file included"))
+            mIncludeChain.clear();
+        mIncludeChain << QString("%0:%1").arg(mIncludedFromPattern.cap(1), mIncludedFromPattern.cap(2));
+        mInIncludeChain = true;
+        return false;
+    }
+    mInIncludeChain = false;
+
+    if (mDiagnosticPattern.indexIn(line) == -1)
+        return false;
+
+    diagnostic = Diagnostic();
+    diagnostic.fileName = mDiagnosticPattern.cap(1);
+    diagnostic.line = mDiagnosticPattern.cap(2).toInt();
+    diagnostic.column = mDiagnosticPattern.cap(3).toInt();
+    QString severity = mDiagnosticPattern.cap(4);
+    if (severity == "warning")
+        diagnostic.severity = Diagnostic::Warning;
+    else if (severity == "note")
+        diagnostic.severity = Diagnostic::Note;
+    else
+        diagnostic.severity = Diagnostic::Error;
+    diagnostic.message = mDiagnosticPattern.cap(5);
+    diagnostic.includeChain = mIncludeChain;
+
+    // the chain applies to the first diagnostic following it only
+    mIncludeChain.clear();
+    return true;
+}
+
+void DiagnosticParser::reset()
+{
+    mIncludeChain.clear();
+    mInIncludeChain = false;
+}
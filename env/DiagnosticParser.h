@@ -0,0 +1,71 @@
+/*
+  DiagnosticParser.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file DiagnosticParser.h
+ * \author Denis Martinez
+ */
+
+#ifndef DIAGNOSTICPARSER_H
+#define DIAGNOSTICPARSER_H
+
+#include <QRegExp>
+#include <QStringList>
+
+#include "Diagnostic.h"
+
+/**
+ * @brief Extract the diagnostics from the output of gcc, line by line
+ *
+ * Handles the file:line:column: prefix of any source type, and the
+ * "In file included from" lines preceding a diagnostic in a header.
+ */
+class DiagnosticParser
+{
+public:
+    DiagnosticParser();
+
+    /**
+     * @brief Parse a line of output
+     *
+     * @param line Line of output, without the end of line
+     * @param diagnostic Filled if the line is a diagnostic
+     * @return bool, True if the line is a diagnostic
+     */
+    bool parseLine(const QString &line, Diagnostic &diagnostic);
+
+    /**
+     * @brief Forget the include chain of the previous lines
+     *
+     * @return void
+     */
+    void reset();
+
+private:
+    QRegExp mDiagnosticPattern;
+    QRegExp mIncludedFromPattern;
+    QStringList mIncludeChain;
+    bool mInIncludeChain;
+};
+
+#endif // DIAGNOSTICPARSER_H
@@ -0,0 +1,136 @@
+/*
+  FirmwareImage.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file FirmwareImage.cpp
+ * \author Denis Martinez
+ */
+
+#include "FirmwareImage.h"
+
+#include <QObject>
+#include <QtAlgorithms>
+
+#include "utils/ElfFile.h"
+#include "utils/IntelHex.h"
+
+// the AVR linker scripts place the other address spaces above the flash
+static const quint32 flashEnd = 0x800000;
+
+static bool lowerAddress(const FirmwareImage::Block &a, const FirmwareImage::Block &b)
+{
+    return a.address < b.address;
+}
+
+bool FirmwareImage::load(const QString &elfFileName)
+{
+    mFlashBlocks.clear();
+    mEeprom.clear();
+
+    ElfFile elf(elfFileName);
+    if (! elf.open())
+    {
+        mErrorString = elf.errorString();
+        return false;
+    }
+
+    foreach (const ElfFile::Section &section, elf.sections())
+    {
+        if (! (section.flags & ElfFile::SectionFlagAlloc) || section.type != ElfFile::SectionProgBits || section.size == 0)
+            continue;
+
+        const uchar *data = elf.sectionData(section);
+        if (data == NULL)
+        {
+            mErrorString = QObject::tr("Truncated section %0.").arg(section.name);
+            return false;
+        }
+
+        if (section.name == ".eeprom")
+        {
+            mEeprom = QByteArray(reinterpret_cast<const char *>(data), section.size);
+            continue;
+        }
+
+        // the initial values of the variables are loaded from the flash,
+        // at the physical address of their segment
+        quint32 address = section.address;
+        foreach (const ElfFile::Segment &segment, elf.segments())
+        {
+            if (segment.type == ElfFile::SegmentLoad && section.offset >= segment.offset
+                    && section.offset + section.size <= segment.offset + segment.fileSize)
+            {
+                address = segment.physicalAddress + section.offset - segment.offset;
+                break;
+            }
+        }
+        if (address >= flashEnd)
+            continue;
+
+        Block block;
+        block.address = address;
+        block.data = QByteArray(reinterpret_cast<const char *>(data), section.size);
+        mFlashBlocks << block;
+    }
+
+    // merge the sections following each other
+    qSort(mFlashBlocks.begin(), mFlashBlocks.end(), lowerAddress);
+    for (int i = 1; i < mFlashBlocks.size(); i++)
+    {
+        Block &previous = mFlashBlocks[i - 1];
+        if (previous.address + previous.data.size() == mFlashBlocks.at(i).address)
+        {
+            previous.data += mFlashBlocks.at(i).data;
+            mFlashBlocks.removeAt(i--);
+        }
+    }
+
+    return true;
+}
+
+QByteArray FirmwareImage::flash() const
+{
+    QByteArray image;
+    foreach (const Block &block, mFlashBlocks)
+    {
+        if (quint32(image.size()) < block.address)
+            image += QByteArray(block.address - image.size(), char(0xff));
+        image.replace(block.address, block.data.size(), block.data);
+    }
+    return image;
+}
+
+bool FirmwareImage::saveFlash(const QString &fileName) const
+{
+    IntelHex hex;
+    foreach (const Block &block, mFlashBlocks)
+        hex.addBlock(block.address, block.data);
+    return hex.save(fileName);
+}
+
+bool FirmwareImage::saveEeprom(const QString &fileName) const
+{
+    IntelHex hex;
+    hex.addBlock(0, mEeprom);
+    return hex.save(fileName);
+}
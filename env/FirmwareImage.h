@@ -0,0 +1,108 @@
+/*
+  FirmwareImage.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file FirmwareImage.h
+ * \author Denis Martinez
+ */
+
+#ifndef FIRMWAREIMAGE_H
+#define FIRMWAREIMAGE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QList>
+
+/**
+ * @brief Flash and EEPROM contents of a linked AVR sketch
+ *
+ * The images are extracted from the ELF file in a single pass, the way
+ * avr-objcopy -R .eeprom and -j .eeprom would.
+ */
+class FirmwareImage
+{
+public:
+    /**
+     * @brief Contiguous range of memory
+     *
+     */
+    struct Block
+    {
+        quint32 address;
+        QByteArray data;
+    };
+
+    /**
+     * @brief Read the images from an ELF file
+     *
+     * @param elfFileName Linked sketch
+     * @return bool, True if success or False if not
+     */
+    bool load(const QString &elfFileName);
+
+    const QString &errorString() const { return mErrorString; }
+
+    /**
+     * @brief Return the flash contents, by increasing addresses
+     *
+     * @return const QList<FirmwareImage::Block>&
+     */
+    const QList<Block> &flashBlocks() const { return mFlashBlocks; }
+
+    /**
+     * @brief Return the flash contents from address 0, holes being filled with 0xff
+     *
+     * @return QByteArray
+     */
+    QByteArray flash() const;
+
+    /**
+     * @brief Return the EEPROM contents, from address 0
+     *
+     * @return const QByteArray&
+     */
+    const QByteArray &eeprom() const { return mEeprom; }
+
+    /**
+     * @brief Save the flash contents in Intel HEX format
+     *
+     * @param fileName File name
+     * @return bool, True if success or False if not
+     */
+    bool saveFlash(const QString &fileName) const;
+
+    /**
+     * @brief Save the EEPROM contents in Intel HEX format
+     *
+     * @param fileName File name
+     * @return bool, True if success or False if not
+     */
+    bool saveEeprom(const QString &fileName) const;
+
+private:
+    QList<Block> mFlashBlocks;
+    QByteArray mEeprom;
+    QString mErrorString;
+};
+
+#endif // FIRMWAREIMAGE_H
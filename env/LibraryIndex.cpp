@@ -0,0 +1,310 @@
+/*
+  LibraryIndex.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file LibraryIndex.cpp
+ * \author Denis Martinez
+ */
+
+#include "LibraryIndex.h"
+
+#include <cstring>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QMutexLocker>
+#include <QMetaObject>
+
+#include "Toolkit.h"
+
+LibraryIndex::LibraryIndex(QObject *parent)
+    : QObject(parent),
+      mWatcher(new QFileSystemWatcher(this)),
+      mValid(false),
+      mRevision(0)
+{
+    connect(mWatcher, SIGNAL(directoryChanged(const QString &)), this, SLOT(directoryChanged(const QString &)));
+    connect(mWatcher, SIGNAL(fileChanged(const QString &)), this, SLOT(fileChanged(const QString &)));
+}
+
+void LibraryIndex::update()
+{
+    QMutexLocker locker(&mMutex);
+
+    QStringList currentRoots = roots();
+    if (! mValid || currentRoots != mRoots)
+    {
+        mRoots = currentRoots;
+        mLibraries.clear();
+        foreach (const QString &root, mRoots)
+        {
+            QDir dir(root);
+            foreach (const QString &name, dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name))
+                mLibraries << scanLibrary(name, dir.filePath(name));
+        }
+        mValid = true;
+    }
+    else if (mDirtyRoots.isEmpty() && mDirtyLibraries.isEmpty())
+        return;
+    else
+    {
+        QHash<QString, int> existing;
+        for (int i = 0; i < mLibraries.size(); i++)
+            existing.insert(mLibraries.at(i).path, i);
+
+        // the libraries stay sorted by root, then by name
+        QList<Library> libraries;
+        foreach (const QString &root, mRoots)
+        {
+            QDir dir(root);
+            QStringList names;
+            if (mDirtyRoots.contains(root))
+                names = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+            else
+            {
+                foreach (const Library &library, mLibraries)
+                {
+                    if (QFileInfo(library.path).path() == root)
+                        names << library.name;
+                }
+            }
+
+            foreach (const QString &name, names)
+            {
+                QString path = dir.filePath(name);
+                int i = existing.value(path, -1);
+                if (i < 0 || mDirtyLibraries.contains(path))
+                    libraries << scanLibrary(name, path);
+                else
+                    libraries << mLibraries.at(i);
+            }
+        }
+        mLibraries = libraries;
+    }
+    mDirtyRoots.clear();
+    mDirtyLibraries.clear();
+
+    rebuildLookup();
+
+    // the watcher belongs to the GUI thread
+    QMetaObject::invokeMethod(this, "updateWatcher", Qt::QueuedConnection);
+}
+
+bool LibraryIndex::find(const QString &include, Library &library)
+{
+    QMutexLocker locker(&mMutex);
+
+    // a library is usually named after its main header, prefer it to any
+    // other library shipping a header with the same name
+    QFileInfo info(include);
+    int index = mNames.value(info.baseName(), -1);
+    if (index < 0)
+        index = mHeaders.value(info.fileName(), -1);
+    if (index < 0)
+        return false;
+
+    library = mLibraries.at(index);
+    return true;
+}
+
+int LibraryIndex::revision()
+{
+    QMutexLocker locker(&mMutex);
+    return mRevision;
+}
+
+QStringList LibraryIndex::scanIncludes(const QByteArray &code)
+{
+    QStringList includes;
+    const char *p = code.constData();
+    const char *end = p + code.size();
+    while (p < end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        if (p < end && *p == '#')
+        {
+            p++;
+            while (p < end && (*p == ' ' || *p == '\t'))
+                p++;
+            if (end - p > 7 && qstrncmp(p, "include", 7) == 0)
+            {
+                p += 7;
+                while (p < end && (*p == ' ' || *p == '\t'))
+                    p++;
+                if (p < end && (*p == '<' || *p == '"'))
+                {
+                    char close = *p == '<' ? '>' : '"';
+                    const char *start = ++p;
+                    while (p < end && *p != close && *p != '\n')
+                        p++;
+                    if (p < end && *p == close && p > start)
+                        includes << QString::fromLocal8Bit(start, p - start);
+                }
+            }
+        }
+
+        // next line
+        const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+        p = newline != NULL ? newline + 1 : end;
+    }
+    return includes;
+}
+
+QStringList LibraryIndex::roots()
+{
+    QStringList roots;
+    foreach (const QString &path, QStringList() << Toolkit::userLibraryPath() << Toolkit::IDELibraryPath() << Toolkit::libraryPath())
+    {
+        if (QFileInfo(path).isDir())
+            roots << QDir(path).absolutePath();
+    }
+    return roots;
+}
+
+LibraryIndex::Library LibraryIndex::scanLibrary(const QString &name, const QString &path)
+{
+    static const QStringList headerFilters = QStringList() << "*.h" << "*.hpp";
+    static const QStringList sourceFilters = QStringList() << "*.S" << "*.c" << "*.cpp";
+
+    Library library;
+    library.name = name;
+    library.path = path;
+
+    QDir dir(path);
+    QStringList headers;
+    foreach (const QString &header, dir.entryList(headerFilters, QDir::Files, QDir::Name))
+    {
+        library.headers << header;
+        headers << dir.filePath(header);
+    }
+    foreach (const QString &source, dir.entryList(sourceFilters, QDir::Files, QDir::Name))
+        library.sources << dir.filePath(source);
+
+    QStringList utilityHeaders;
+    QDir utility(dir.filePath("utility"));
+    if (utility.exists())
+    {
+        library.utilityPath = utility.path();
+        foreach (const QString &header, utility.entryList(headerFilters, QDir::Files, QDir::Name))
+            utilityHeaders << utility.filePath(header);
+        foreach (const QString &source, utility.entryList(sourceFilters, QDir::Files, QDir::Name))
+            library.utilitySources << utility.filePath(source);
+    }
+
+    library.files = headers + utilityHeaders + library.sources + library.utilitySources;
+    library.includes = scanFiles(headers + utilityHeaders + library.sources);
+    library.utilityIncludes = scanFiles(utilityHeaders + library.utilitySources);
+    return library;
+}
+
+QStringList LibraryIndex::scanFiles(const QStringList &fileNames)
+{
+    QStringList includes;
+    QSet<QString> seen;
+    foreach (const QString &fileName, fileNames)
+    {
+        QFile file(fileName);
+        if (! file.open(QIODevice::ReadOnly))
+            continue;
+
+        foreach (const QString &include, scanIncludes(file.readAll()))
+        {
+            if (! seen.contains(include))
+            {
+                seen.insert(include);
+                includes << include;
+            }
+        }
+    }
+    return includes;
+}
+
+void LibraryIndex::rebuildLookup()
+{
+    mHeaders.clear();
+    mNames.clear();
+    mOwners.clear();
+    mWatchedPaths = mRoots;
+    mRevision++;
+
+    // the libraries are sorted by priority, the first one found wins
+    for (int i = 0; i < mLibraries.size(); i++)
+    {
+        const Library &library = mLibraries.at(i);
+        if (! mNames.contains(library.name))
+            mNames.insert(library.name, i);
+
+        foreach (const QString &header, library.headers)
+        {
+            if (! mHeaders.contains(header))
+                mHeaders.insert(header, i);
+        }
+
+        // an edited file only notifies its own watch, not its directory
+        QStringList paths = QStringList() << library.path << library.files;
+        if (! library.utilityPath.isEmpty())
+            paths << library.utilityPath;
+        foreach (const QString &path, paths)
+            mOwners.insert(path, library.path);
+        mWatchedPaths << paths;
+    }
+}
+
+void LibraryIndex::directoryChanged(const QString &path)
+{
+    QMutexLocker locker(&mMutex);
+
+    // a library was added or removed
+    if (mRoots.contains(path))
+        mDirtyRoots.insert(path);
+    else if (mOwners.contains(path))
+        mDirtyLibraries.insert(mOwners.value(path));
+}
+
+void LibraryIndex::fileChanged(const QString &path)
+{
+    QMutexLocker locker(&mMutex);
+
+    if (mOwners.contains(path))
+        mDirtyLibraries.insert(mOwners.value(path));
+}
+
+void LibraryIndex::updateWatcher()
+{
+    QSet<QString> wanted;
+    {
+        QMutexLocker locker(&mMutex);
+        wanted = mWatchedPaths.toSet();
+    }
+
+    QSet<QString> current = (mWatcher->directories() + mWatcher->files()).toSet();
+    QStringList removed = (current - wanted).toList();
+    QStringList added = (wanted - current).toList();
+    if (! removed.isEmpty())
+        mWatcher->removePaths(removed);
+    if (! added.isEmpty())
+        mWatcher->addPaths(added);
+}
@@ -0,0 +1,181 @@
+/*
+  LibraryIndex.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file LibraryIndex.h
+ * \author Denis Martinez
+ */
+
+#ifndef LIBRARYINDEX_H
+#define LIBRARYINDEX_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+
+class QFileSystemWatcher;
+
+/**
+ * @brief Index of the installed libraries, used to resolve the includes of a sketch
+ *
+ * The user, IDE and Arduino library directories are scanned once, then kept
+ * up to date by watching them, along with the directories and files of each
+ * library: only the libraries added, removed or edited are scanned again.
+ * Each library records its sources and the includes of its files, so
+ * resolving the dependencies of a sketch does not read the files again. The
+ * index is shared with the build thread.
+ */
+class LibraryIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Library found by the index
+     *
+     */
+    struct Library
+    {
+        QString name;
+        QString path;
+        QString utilityPath;
+        QStringList headers;
+        QStringList sources;
+        QStringList utilitySources;
+        QStringList includes;
+        QStringList utilityIncludes;
+        QStringList files;
+    };
+
+    /**
+     * @brief Rescan what changed since the last call
+     *
+     * Also notices changes of the library directories in the settings.
+     *
+     * @return void
+     */
+    void update();
+
+    /**
+     * @brief Find the library providing a header
+     *
+     * @param include Header, as written in the #include directive
+     * @param library Filled with the library
+     * @return bool, True if a library was found or False if not
+     */
+    bool find(const QString &include, Library &library);
+
+    /**
+     * @brief Return a number changing each time the index is rebuilt
+     *
+     * @return int
+     */
+    int revision();
+
+    /**
+     * @brief Extract the headers included by some code
+     *
+     * @param code Code
+     * @return QStringList
+     */
+    static QStringList scanIncludes(const QByteArray &code);
+
+private:
+    LibraryIndex(QObject *parent = NULL);
+
+    /**
+     * @brief Return the directories libraries are searched in, by priority
+     *
+     * @return QStringList
+     */
+    static QStringList roots();
+
+    /**
+     * @brief Read the contents of a library directory
+     *
+     * @param name Library name
+     * @param path Library directory
+     * @return LibraryIndex::Library
+     */
+    static Library scanLibrary(const QString &name, const QString &path);
+
+    /**
+     * @brief Extract the headers included by a list of files
+     *
+     * @param fileNames Files
+     * @return QStringList, without duplicates
+     */
+    static QStringList scanFiles(const QStringList &fileNames);
+
+    /**
+     * @brief Rebuild the header lookup tables from the libraries
+     *
+     * @return void
+     */
+    void rebuildLookup();
+
+    QMutex mMutex;
+    QFileSystemWatcher *mWatcher;
+    QStringList mRoots;
+    bool mValid;
+    int mRevision;
+    QList<Library> mLibraries;
+    QSet<QString> mDirtyRoots;
+    QSet<QString> mDirtyLibraries;
+    QHash<QString, int> mHeaders;
+    QHash<QString, int> mNames;
+    QHash<QString, QString> mOwners;
+    QStringList mWatchedPaths;
+
+    friend class IDEApplication;
+
+private slots:
+    /**
+     * @brief Mark the library or library directory owning a directory for rescanning
+     *
+     * @param path Modified directory
+     * @return void
+     */
+    void directoryChanged(const QString &path);
+
+    /**
+     * @brief Mark the library owning a file for rescanning
+     *
+     * @param path Modified file
+     * @return void
+     */
+    void fileChanged(const QString &path);
+
+    /**
+     * @brief Watch the directories and files found by the last scan
+     *
+     * @return void
+     */
+    void updateWatcher();
+};
+
+#endif // LIBRARYINDEX_H
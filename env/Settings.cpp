@@ -29,12 +29,16 @@ This program is free software; you can redistribute it and/or modify
 #include "Settings.h"
 
 #include <QFileInfo>
+#include <QUrl>
 #include <QDebug>
 
 #include "gui/LexerArduino.h"
 #include "gui/Editor.h"
 #include "Toolkit.h"
 
+// the serial monitor keeps its scrollback in memory, in KiB
+static const int maxSerialScrollback = 64 * 1024;
+
 Settings::Settings()
 {
 }
@@ -47,6 +51,7 @@ QString Settings::arduinoPath() const
 void Settings::setArduinoPath(const QString &path)
 {
     mSettings.setValue("arduinoPath", path);
+    Toolkit::invalidateContext();
 }
 
 QString Settings::sketchPath() const
@@ -57,6 +62,7 @@ QString Settings::sketchPath() const
 void Settings::setSketchPath(const QString &path)
 {
     mSettings.setValue("sketchPath", path);
+    Toolkit::invalidateContext();
 }
 
 QString Settings::devicePort() const
@@ -99,6 +105,69 @@ void Settings::setVerboseUpload(bool verbose)
     mSettings.setValue("verboseUpload", verbose);
 }
 
+int Settings::buildJobs() const
+{
+    return mSettings.value("buildJobs", 0).toInt();
+}
+
+void Settings::setBuildJobs(int jobs)
+{
+    mSettings.setValue("buildJobs", jobs);
+}
+
+bool Settings::buildTiming() const
+{
+    return mSettings.value("buildTiming", false).toBool();
+}
+
+void Settings::setBuildTiming(bool enabled)
+{
+    mSettings.setValue("buildTiming", enabled);
+}
+
+bool Settings::syntaxCheck() const
+{
+    return mSettings.value("syntaxCheck", false).toBool();
+}
+
+void Settings::setSyntaxCheck(bool enabled)
+{
+    mSettings.setValue("syntaxCheck", enabled);
+}
+
+int Settings::serialScrollback() const
+{
+    return qBound(16, mSettings.value("serialScrollback", 1024).toInt(), maxSerialScrollback);
+}
+
+void Settings::setSerialScrollback(int size)
+{
+    mSettings.setValue("serialScrollback", size);
+}
+
+QString Settings::buildProfile(const QString &sketch) const
+{
+    QString profile = mSettings.value("buildProfile", Toolkit::defaultBuildProfile()).toString();
+    if (sketch.isEmpty())
+        return profile;
+    return mSettings.value(buildProfileKey(sketch), profile).toString();
+}
+
+void Settings::setBuildProfile(const QString &sketch, const QString &profile)
+{
+    if (sketch.isEmpty())
+        mSettings.setValue("buildProfile", profile);
+    else
+        mSettings.setValue(buildProfileKey(sketch), profile);
+}
+
+QString Settings::buildProfileKey(const QString &sketch)
+{
+    // the path must not be split into groups
+    QByteArray path = QUrl::toPercentEncoding(QFileInfo(sketch).absoluteFilePath());
+    return QString("buildProfiles/%0").arg(QString::fromLatin1(path));
+}
+
 void Settings::loadLexerProperties(LexerArduino *lexer)
 {
     if (! lexer->readSettings(mSettings))
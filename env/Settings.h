@@ -133,6 +133,88 @@ public:
      */
     void setVerboseUpload(bool verbose);
 
+    /**
+     * @brief Return the number of parallel compile jobs, 0 meaning one per core
+     *
+     * @return int
+     */
+    int buildJobs() const;
+
+    /**
+     * @brief Set the number of parallel compile jobs
+     *
+     * @param jobs Number of jobs, 0 for one per core
+     * @return void
+     */
+    void setBuildJobs(int jobs);
+
+    /**
+     * @brief Return True if the duration of the build phases is reported
+     *
+     * @return bool
+     */
+    bool buildTiming() const;
+
+    /**
+     * @brief Report the duration of the build phases and save a trace of each build
+     *
+     * @param enabled True to enable the timings
+     * @return void
+     */
+    void setBuildTiming(bool enabled);
+
+    /**
+     * @brief Return True if the sketch is checked in the background while editing
+     *
+     * @return bool
+     */
+    bool syntaxCheck() const;
+
+    /**
+     * @brief Check the sketch for errors whenever the editor goes idle
+     *
+     * @param enabled True to enable the checks
+     * @return void
+     */
+    void setSyntaxCheck(bool enabled);
+
+    /**
+     * @brief Return the size of the serial monitor scrollback
+     *
+     * @return int, in KiB, at most 64 MiB
+     */
+    int serialScrollback() const;
+
+    /**
+     * @brief Set the size of the serial monitor scrollback
+     *
+     * The oldest data is dropped from the view past this size.
+     *
+     * @param size Size, in KiB
+     * @return void
+     */
+    void setSerialScrollback(int size);
+
+    /**
+     * @brief Return the build profile of a sketch
+     *
+     * The sketches without a profile of their own, and the sketches not
+     * saved yet, use the profile last stored without a sketch.
+     *
+     * @param sketch Main file of the sketch, or empty
+     * @return QString
+     */
+    QString buildProfile(const QString &sketch) const;
+
+    /**
+     * @brief Store the build profile of a sketch
+     *
+     * @param sketch Main file of the sketch, or empty for the default profile
+     * @param profile Build profile, see Toolkit::buildProfiles()
+     * @return void
+     */
+    void setBuildProfile(const QString &sketch, const QString &profile);
+
     /**
      * @brief TODO
      * 
@@ -187,6 +269,15 @@ signals:
 
 private:
     Settings();
+
+    /**
+     * @brief Return the key the build profile of a sketch is stored under
+     *
+     * @param sketch Main file of the sketch
+     * @return QString
+     */
+    static QString buildProfileKey(const QString &sketch);
+
     QSettings mSettings;
 
     friend class IDEApplication;
@@ -0,0 +1,271 @@
+/*
+  SizeAnalyzer.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file SizeAnalyzer.cpp
+ * \author Denis Martinez
+ */
+
+#include "SizeAnalyzer.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QStringList>
+#include <QtAlgorithms>
+#include <QObject>
+#include <cstdlib>
+
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+#include "utils/ElfFile.h"
+
+static bool biggerThan(const SizeAnalyzer::Item &a, const SizeAnalyzer::Item &b)
+{
+    return a.flash + a.ram > b.flash + b.ram;
+}
+
+SizeAnalyzer::SizeAnalyzer()
+    : mText(0),
+      mData(0),
+      mBss(0),
+      mEeprom(0)
+{
+}
+
+bool SizeAnalyzer::analyze(const QString &elfFileName, const QString &mapFileName)
+{
+    mText = mData = mBss = mEeprom = 0;
+    mSymbols.clear();
+    mObjects.clear();
+
+    ElfFile elf(elfFileName);
+    if (! elf.open())
+    {
+        mErrorString = elf.errorString();
+        return false;
+    }
+
+    const QList<ElfFile::Section> &sections = elf.sections();
+    foreach (const ElfFile::Section &section, sections)
+    {
+        if (! (section.flags & ElfFile::SectionFlagAlloc))
+            continue;
+
+        if (section.name == ".text")
+            mText += section.size;
+        else if (section.name == ".data")
+            mData += section.size;
+        else if (section.name == ".bss" || section.name == ".noinit")
+            mBss += section.size;
+        else if (section.name == ".eeprom")
+            mEeprom += section.size;
+    }
+
+    foreach (const ElfFile::Symbol &symbol, elf.symbols())
+    {
+        if (symbol.size == 0 || symbol.sectionIndex >= sections.size()
+                || (symbol.type != ElfFile::SymbolFunction && symbol.type != ElfFile::SymbolObject))
+            continue;
+
+        int memory = memoryOf(sections.at(symbol.sectionIndex).name);
+        if (memory == 0)
+            continue;
+
+        Item item;
+        item.name = demangle(symbol.name);
+        item.flash = memory & Flash ? symbol.size : 0;
+        item.ram = memory & Ram ? symbol.size : 0;
+        mSymbols << item;
+    }
+    qStableSort(mSymbols.begin(), mSymbols.end(), biggerThan);
+
+    if (! mapFileName.isEmpty())
+        readMap(mapFileName);
+
+    return true;
+}
+
+quint32 SizeAnalyzer::ramSize(const QString &mcu)
+{
+    // constant, so that builders running in parallel can share it
+    static const struct
+    {
+        const char *mcu;
+        quint32 size;
+    } sizes[] = {
+        { "attiny44", 256 },
+        { "attiny45", 256 },
+        { "attiny84", 512 },
+        { "attiny85", 512 },
+        { "atmega8", 1024 },
+        { "atmega16u2", 512 },
+        { "atmega168", 1024 },
+        { "atmega168p", 1024 },
+        { "atmega328", 2048 },
+        { "atmega328p", 2048 },
+        { "atmega32u4", 2560 },
+        { "atmega644", 4096 },
+        { "atmega644p", 4096 },
+        { "atmega1280", 8192 },
+        { "atmega1284p", 16384 },
+        { "atmega2560", 8192 },
+        { "at90usb1286", 8192 },
+    };
+
+    QString name = mcu.toLower();
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        if (name == QLatin1String(sizes[i].mcu))
+            return sizes[i].size;
+    }
+    return 0;
+}
+
+QString SizeAnalyzer::demangle(const QString &name)
+{
+#ifdef __GNUC__
+    if (name.startsWith("_Z"))
+    {
+        int status = 0;
+        char *demangled = abi::__cxa_demangle(name.toLatin1().constData(), NULL, NULL, &status);
+        if (demangled != NULL)
+        {
+            QString result = QString::fromLatin1(demangled);
+            free(demangled);
+            if (status == 0)
+                return result;
+        }
+    }
+#endif
+    return name;
+}
+
+int SizeAnalyzer::memoryOf(const QString &sectionName)
+{
+    if (sectionName == ".text")
+        return Flash;
+    else if (sectionName == ".data")
+        return Flash | Ram;
+    else if (sectionName == ".bss" || sectionName == ".noinit")
+        return Ram;
+    return 0;
+}
+
+bool SizeAnalyzer::readMap(const QString &fileName)
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    // input sections look like " .text.loop  0x000000ba  0x10 /path/sketch.cpp.o",
+    // long section names being alone on their line
+    bool inMemoryMap = false;
+    int memory = 0;
+    bool pendingInput = false;
+    QHash<QString, Item> objects;
+    QRegExp whitespace("\\s+");
+    while (! file.atEnd())
+    {
+        QString line = QString::fromLocal8Bit(file.readLine());
+        if (line.endsWith('\n'))
+            line.chop(1);
+
+        if (! inMemoryMap)
+        {
+            inMemoryMap = line.startsWith("Linker script and memory map");
+            continue;
+        }
+        if (line.isEmpty())
+            continue;
+
+        // an output section starts
+        if (line.at(0) == '.')
+        {
+            memory = memoryOf(line.section(whitespace, 0, 0));
+            pendingInput = false;
+            continue;
+        }
+        if (line.at(0) != ' ' || memory == 0)
+            continue;
+
+        QStringList fields = line.split(whitespace, QString::SkipEmptyParts);
+        if (fields.size() == 1 && fields.first().startsWith('.'))
+        {
+            pendingInput = true;
+            continue;
+        }
+
+        int sizeField;
+        if (fields.size() >= 4 && fields.at(0).startsWith('.') && fields.at(1).startsWith("0x"))
+            sizeField = 2;
+        else if (pendingInput && fields.size() >= 3 && fields.at(0).startsWith("0x") && fields.at(1).startsWith("0x"))
+            sizeField = 1;
+        else
+        {
+            pendingInput = false;
+            continue;
+        }
+        pendingInput = false;
+
+        bool ok;
+        quint32 size = fields.at(sizeField).mid(2).toUInt(&ok, 16);
+        if (! ok || size == 0)
+            continue;
+
+        QString name = objectName(QStringList(fields.mid(sizeField + 1)).join(" "));
+        if (! objects.contains(name))
+        {
+            Item item;
+            item.name = name;
+            item.flash = 0;
+            item.ram = 0;
+            objects.insert(name, item);
+        }
+        Item &item = objects[name];
+        if (memory & Flash)
+            item.flash += size;
+        if (memory & Ram)
+            item.ram += size;
+    }
+
+    mObjects = objects.values();
+    qStableSort(mObjects.begin(), mObjects.end(), biggerThan);
+    return true;
+}
+
+QString SizeAnalyzer::objectName(const QString &fileName) const
+{
+    // members of an archive are accounted to the archive
+    static QRegExp memberPattern("^(.+)\\((.+)\\)$");
+    QRegExp pattern(memberPattern);
+    if (pattern.indexIn(fileName) != -1)
+        return QFileInfo(pattern.cap(1)).fileName();
+
+    QHash<QString, QString>::const_iterator it = mObjectNames.constFind(fileName);
+    if (it != mObjectNames.constEnd())
+        return *it;
+    return QFileInfo(fileName).fileName();
+}
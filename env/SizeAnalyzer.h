@@ -0,0 +1,147 @@
+/*
+  SizeAnalyzer.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file SizeAnalyzer.h
+ * \author Denis Martinez
+ */
+
+#ifndef SIZEANALYZER_H
+#define SIZEANALYZER_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+
+/**
+ * @brief Memory usage of a linked sketch
+ *
+ * The section sizes and the symbols are read from the ELF file, the sizes
+ * per object file from the map written by the linker.
+ */
+class SizeAnalyzer
+{
+public:
+    /**
+     * @brief Bytes used by a symbol or an object file
+     *
+     */
+    struct Item
+    {
+        QString name;
+        quint32 flash;
+        quint32 ram;
+    };
+
+    SizeAnalyzer();
+
+    /**
+     * @brief Give the objects passed to the linker a readable name
+     *
+     * @param names Names indexed by the object file names
+     * @return void
+     */
+    void setObjectNames(const QHash<QString, QString> &names) { mObjectNames = names; }
+
+    /**
+     * @brief Read the memory usage of a sketch
+     *
+     * @param elfFileName Linked sketch
+     * @param mapFileName Map written by the linker, if any
+     * @return bool, True if success or False if not
+     */
+    bool analyze(const QString &elfFileName, const QString &mapFileName = QString());
+
+    const QString &errorString() const { return mErrorString; }
+
+    quint32 textSize() const { return mText; }
+    quint32 dataSize() const { return mData; }
+    quint32 bssSize() const { return mBss; }
+    quint32 eepromSize() const { return mEeprom; }
+
+    /**
+     * @brief Program memory used, code and initial values of the variables
+     *
+     * @return quint32
+     */
+    quint32 flashUsage() const { return mText + mData; }
+
+    /**
+     * @brief Static RAM used by the variables
+     *
+     * @return quint32
+     */
+    quint32 ramUsage() const { return mData + mBss; }
+
+    /**
+     * @brief Functions and variables, the biggest first
+     *
+     * @return const QList<SizeAnalyzer::Item>&
+     */
+    const QList<Item> &symbols() const { return mSymbols; }
+
+    /**
+     * @brief Object files and archives, the biggest first
+     *
+     * @return const QList<SizeAnalyzer::Item>&
+     */
+    const QList<Item> &objects() const { return mObjects; }
+
+    /**
+     * @brief Return the RAM size of a mcu
+     *
+     * @param mcu Mcu, as in build.mcu
+     * @return quint32, 0 if unknown
+     */
+    static quint32 ramSize(const QString &mcu);
+
+    /**
+     * @brief Demangle a C++ symbol name
+     *
+     * @param name Symbol name
+     * @return QString, the name itself if it is not mangled
+     */
+    static QString demangle(const QString &name);
+
+private:
+    enum Memory
+    {
+        Flash = 0x1,
+        Ram = 0x2
+    };
+
+    static int memoryOf(const QString &sectionName);
+    bool readMap(const QString &fileName);
+    QString objectName(const QString &fileName) const;
+
+    QHash<QString, QString> mObjectNames;
+    QString mErrorString;
+    quint32 mText;
+    quint32 mData;
+    quint32 mBss;
+    quint32 mEeprom;
+    QList<Item> mSymbols;
+    QList<Item> mObjects;
+};
+
+#endif // SIZEANALYZER_H
@@ -0,0 +1,348 @@
+/*
+  SketchPreprocessor.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file SketchPreprocessor.cpp
+ * \author Denis Martinez
+ */
+
+#include "SketchPreprocessor.h"
+
+#include <QSet>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QCryptographicHash>
+
+// sources kept in memory, the cache is emptied when it gets bigger
+static const int maxCachedSources = 32;
+
+static bool isWordChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == '_';
+}
+
+SketchPreprocessor::SketchPreprocessor()
+{
+}
+
+QString SketchPreprocessor::process(const QString &code, const QString &fileName)
+{
+    return process(QStringList() << code, QStringList() << fileName);
+}
+
+QString SketchPreprocessor::process(const QStringList &codes, const QStringList &fileNames)
+{
+    static QMutex mutex;
+    static QHash<QByteArray, Result> results;
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (int i = 0; i < codes.size(); i++)
+    {
+        hash.addData(fileNames.at(i).toUtf8());
+        hash.addData("\n", 1);
+        hash.addData(codes.at(i).toUtf8());
+        hash.addData("\0", 1);
+    }
+    QByteArray key = hash.result();
+
+    {
+        QMutexLocker locker(&mutex);
+        QHash<QByteArray, Result>::const_iterator it = results.constFind(key);
+        if (it != results.constEnd())
+        {
+            mLineMap = it->lineMap;
+            return it->source;
+        }
+    }
+
+    Result result = generate(codes, fileNames);
+    {
+        QMutexLocker locker(&mutex);
+        if (results.size() >= maxCachedSources)
+            results.clear();
+        results.insert(key, result);
+    }
+    mLineMap = result.lineMap;
+    return result.source;
+}
+
+int SketchPreprocessor::sketchLine(int line) const
+{
+    if (line < 1 || line > mLineMap.size())
+        return 0;
+    return mLineMap.at(line - 1);
+}
+
+SketchPreprocessor::Result SketchPreprocessor::generate(const QStringList &codes, const QStringList &fileNames)
+{
+    static const QString lineDirective("#line %0 \"%1\"");
+
+    QStringList names;
+    foreach (QString name, fileNames)
+        names << name.replace('\\', "\\\\").replace('"', "\\\"");
+
+    // the functions of all the files, declared before the first of them
+    QList<QStringList> definitions;
+    QList<QList<int> > definitionLines;
+    QSet<QString> declared;
+    int insertionFile = -1;
+    int insertionLine = 0;
+    for (int i = 0; i < codes.size(); i++)
+    {
+        QList<int> lines;
+        definitions << prototypes(codes.at(i), lines, declared);
+        definitionLines << lines;
+        if (insertionFile < 0 && ! lines.isEmpty())
+        {
+            insertionFile = i;
+            insertionLine = lines.first();
+        }
+    }
+
+    Result result;
+    for (int i = 0; i < codes.size(); i++)
+    {
+        QStringList lines = codes.at(i).split('\n');
+        addLine(result, lineDirective.arg(1).arg(names.at(i)), 0);
+        for (int j = 0; j < lines.size(); j++)
+        {
+            int line = j + 1;
+            if (i == insertionFile && line == insertionLine)
+            {
+                // each prototype points to its function
+                for (int k = 0; k < definitions.size(); k++)
+                {
+                    for (int l = 0; l < definitions.at(k).size(); l++)
+                    {
+                        if (declared.contains(definitions.at(k).at(l)))
+                            continue;
+                        int definitionLine = definitionLines.at(k).at(l);
+                        addLine(result, lineDirective.arg(definitionLine).arg(names.at(k)), 0);
+                        addLine(result, definitions.at(k).at(l), k == 0 ? definitionLine : 0);
+                    }
+                }
+                addLine(result, lineDirective.arg(line).arg(names.at(i)), 0);
+            }
+            addLine(result, lines.at(j), i == 0 ? line : 0);
+        }
+    }
+    return result;
+}
+
+void SketchPreprocessor::addLine(Result &result, const QString &text, int sketchLine)
+{
+    result.source += text;
+    result.source += '\n';
+    result.lineMap << sketchLine;
+}
+
+QStringList SketchPreprocessor::prototypes(const QString &code, QList<int> &lines, QSet<QString> &declared)
+{
+    QStringList prototypes;
+    lines.clear();
+
+    // tokens of the top level declaration being read
+    QList<Token> tokens;
+    int depth = 0;
+    int line = 1;
+    bool lineStart = true;
+
+    const QChar *p = code.constData();
+    const QChar *end = p + code.size();
+    while (p < end)
+    {
+        QChar c = *p;
+        if (c == '\n')
+        {
+            line++;
+            lineStart = true;
+            p++;
+            continue;
+        }
+        if (c.isSpace())
+        {
+            p++;
+            continue;
+        }
+
+        // comments
+        if (c == '/' && p + 1 < end && p[1] == '/')
+        {
+            while (p < end && *p != '\n')
+                p++;
+            continue;
+        }
+        if (c == '/' && p + 1 < end && p[1] == '*')
+        {
+            p += 2;
+            while (p < end && ! (*p == '*' && p + 1 < end && p[1] == '/'))
+            {
+                if (*p == '\n')
+                    line++;
+                p++;
+            }
+            p = p + 2 < end ? p + 2 : end;
+            continue;
+        }
+
+        // preprocessor directives, with their continuation lines
+        if (c == '#' && lineStart)
+        {
+            while (p < end && *p != '\n')
+            {
+                if (*p == '\\' && p + 1 < end && p[1] == '\n')
+                {
+                    line++;
+                    p++;
+                }
+                p++;
+            }
+            if (depth == 0)
+                tokens.clear();
+            continue;
+        }
+        lineStart = false;
+
+        Token token;
+        token.line = line;
+        if (c == '"' || c == '\'')
+        {
+            const QChar *start = p++;
+            while (p < end && *p != c && *p != '\n')
+            {
+                if (*p == '\\' && p + 1 < end)
+                {
+                    if (p[1] == '\n')
+                        line++;
+                    p++;
+                }
+                p++;
+            }
+            if (p < end && *p == c)
+                p++;
+            token.text = QString(start, p - start);
+        }
+        else if (isWordChar(c))
+        {
+            const QChar *start = p;
+            while (p < end && isWordChar(*p))
+                p++;
+            token.text = QString(start, p - start);
+        }
+        else if (c == ':' && p + 1 < end && p[1] == ':')
+        {
+            token.text = "::";
+            p += 2;
+        }
+        else
+        {
+            token.text = c;
+            p++;
+        }
+
+        // function bodies and type definitions are skipped
+        if (depth > 0)
+        {
+            if (token.text == "{")
+                depth++;
+            else if (token.text == "}" && --depth == 0)
+                tokens.clear();
+            continue;
+        }
+
+        QString prototype;
+        if (token.text == "{")
+        {
+            if (toPrototype(tokens, prototype))
+            {
+                prototypes << prototype;
+                lines << tokens.first().line;
+            }
+            depth = 1;
+            tokens.clear();
+        }
+        else if (token.text == ";")
+        {
+            // the sketch declared the function itself
+            if (toPrototype(tokens, prototype))
+                declared.insert(prototype);
+            tokens.clear();
+        }
+        else if (token.text == "}")
+            tokens.clear();
+        else
+            tokens << token;
+    }
+
+    return prototypes;
+}
+
+bool SketchPreprocessor::toPrototype(const QList<Token> &tokens, QString &prototype)
+{
+    static const QSet<QString> keywords = QSet<QString>()
+        << "class" << "struct" << "union" << "enum" << "namespace" << "typedef" << "using";
+
+    // a return type and a name come before the parameters, which end the
+    // declaration: this leaves out the macros like ISR(vector)
+    int open = -1;
+    for (int i = 0; i < tokens.size() && open < 0; i++)
+    {
+        const QString &text = tokens.at(i).text;
+        if (text == "(")
+            open = i;
+        else if (text == "=" || keywords.contains(text))
+            return false;
+    }
+    if (open < 2 || tokens.last().text != ")")
+        return false;
+
+    const QString &name = tokens.at(open - 1).text;
+    if (! isWordChar(name.at(0)) || name.at(0).isDigit() || tokens.at(open - 2).text == "::")
+        return false;
+
+    int level = 0;
+    for (int i = open; i < tokens.size(); i++)
+    {
+        const QString &text = tokens.at(i).text;
+        if (text == "(")
+            level++;
+        else if (text == ")" && --level == 0 && i != tokens.size() - 1)
+            return false;
+        // default arguments can't be given twice
+        else if (text == "=")
+            return false;
+    }
+
+    prototype.clear();
+    foreach (const Token &token, tokens)
+    {
+        if (! prototype.isEmpty() && isWordChar(prototype.at(prototype.size() - 1)) && isWordChar(token.text.at(0)))
+            prototype += ' ';
+        prototype += token.text;
+        if (token.text == ",")
+            prototype += ' ';
+    }
+    prototype += ';';
+    return true;
+}
@@ -0,0 +1,136 @@
+/*
+  SketchPreprocessor.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file SketchPreprocessor.h
+ * \author Denis Martinez
+ */
+
+#ifndef SKETCHPREPROCESSOR_H
+#define SKETCHPREPROCESSOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSet>
+
+/**
+ * @brief Turn a sketch into a C++ source, like the official IDE does
+ *
+ * Prototypes are generated for the functions of the sketch, so they can be
+ * used before their definition. #line directives make the compiler report
+ * the lines of the sketch, and a source map gives the line of the sketch
+ * each line of the source comes from. The sources are cached by the hash of
+ * the sketch.
+ */
+class SketchPreprocessor
+{
+public:
+    SketchPreprocessor();
+
+    /**
+     * @brief Generate the C++ source of a sketch
+     *
+     * @param code Code of the sketch
+     * @param fileName File name of the sketch in the #line directives
+     * @return QString
+     */
+    QString process(const QString &code, const QString &fileName);
+
+    /**
+     * @brief Generate a single C++ source from the files of a sketch
+     *
+     * The files are concatenated, and the prototypes of the functions of
+     * all the files go before the first function.
+     *
+     * @param codes Code of each file, the main file first
+     * @param fileNames File name of each file in the #line directives
+     * @return QString
+     */
+    QString process(const QStringList &codes, const QStringList &fileNames);
+
+    /**
+     * @brief Return the line of the main file a line of the last source comes from
+     *
+     * @param line Line of the source, starting from 1
+     * @return int, 0 for the generated lines and the lines of the other files
+     */
+    int sketchLine(int line) const;
+
+private:
+    struct Token
+    {
+        QString text;
+        int line;
+    };
+
+    struct Result
+    {
+        QString source;
+        QList<int> lineMap;
+    };
+
+    /**
+     * @brief Return the prototypes of the functions defined in a file
+     *
+     * Member functions and functions with default arguments are left out.
+     *
+     * @param code Code of the file
+     * @param lines Filled with the line of each function
+     * @param declared Filled with the functions the file declares itself
+     * @return QStringList
+     */
+    static QStringList prototypes(const QString &code, QList<int> &lines, QSet<QString> &declared);
+
+    /**
+     * @brief Generate the source of a sketch, see process()
+     *
+     * @param codes Code of each file, the main file first
+     * @param fileNames File name of each file in the #line directives
+     * @return SketchPreprocessor::Result
+     */
+    static Result generate(const QStringList &codes, const QStringList &fileNames);
+
+    /**
+     * @brief Return the prototype of a function, from the tokens preceding its body or a semicolon
+     *
+     * @param tokens Tokens of the declaration
+     * @param prototype Filled with the prototype
+     * @return bool, True if the tokens declare a function or False if not
+     */
+    static bool toPrototype(const QList<Token> &tokens, QString &prototype);
+
+    /**
+     * @brief Append a line to a source
+     *
+     * @param result Source and its map
+     * @param text Line
+     * @param sketchLine Line of the sketch, 0 for a generated line
+     * @return void
+     */
+    static void addLine(Result &result, const QString &text, int sketchLine);
+
+    QList<int> mLineMap;
+};
+
+#endif // SKETCHPREPROCESSOR_H
@@ -0,0 +1,208 @@
+/*
+  StubToolchain.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file StubToolchain.cpp
+ * \author Denis Martinez
+ */
+
+#include "StubToolchain.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QRegExp>
+#include <QtEndian>
+#include <QCoreApplication>
+
+#include "utils/Compat.h"
+
+static const char *stubTools[] = { "avr-gcc", "avr-g++", "avr-ar", "avr-gcc-ar" };
+
+// size of the code of the stub sketch, small enough for any board
+static const quint32 stubTextSize = 1024;
+
+static void put16(QByteArray &data, int offset, quint16 value)
+{
+    qToLittleEndian<quint16>(value, reinterpret_cast<uchar *>(data.data() + offset));
+}
+
+static void put32(QByteArray &data, int offset, quint32 value)
+{
+    qToLittleEndian<quint32>(value, reinterpret_cast<uchar *>(data.data() + offset));
+}
+
+bool StubToolchain::isInvoked(const char *argv0)
+{
+    QString name = QFileInfo(QString::fromLocal8Bit(argv0)).completeBaseName();
+    for (size_t i = 0; i < sizeof(stubTools) / sizeof(stubTools[0]); i++)
+    {
+        if (name == stubTools[i])
+            return true;
+    }
+    return false;
+}
+
+int StubToolchain::run(int argc, char **argv)
+{
+    QString tool = QFileInfo(QString::fromLocal8Bit(argv[0])).completeBaseName();
+    QStringList arguments;
+    for (int i = 1; i < argc; i++)
+        arguments << QString::fromLocal8Bit(argv[i]);
+
+    int delay = qgetenv("ARDUIDE_STUB_DELAY").toInt();
+    if (delay > 0)
+        Compat::sleep_ms(delay);
+
+    if (arguments.contains("-dumpversion"))
+    {
+        fputs("0.0.0-stub\n", stdout);
+        return 0;
+    }
+
+    // avr-ar rcs archive objects...
+    if (tool == "avr-ar" || tool == "avr-gcc-ar")
+        return arguments.size() >= 2 && writeFile(arguments.at(1), "!<arch>\n") ? 0 : 1;
+
+    if (arguments.contains("-fsyntax-only"))
+        return 0;
+
+    int index = arguments.indexOf("-o");
+    if (index < 0 || index + 1 >= arguments.size())
+    {
+        fprintf(stderr, "%s: no output file\n", argv[0]);
+        return 1;
+    }
+    QString output = arguments.at(index + 1);
+
+    if (arguments.contains("-c"))
+    {
+        if (! writeFile(output, QByteArray()))
+            return 1;
+
+        // the source comes last, the object has no other prerequisite
+        if (arguments.contains("-MMD"))
+        {
+            QString depFileName = output;
+            depFileName.replace(QRegExp("\\.o$"), ".d");
+            QByteArray rule = output.toLocal8Bit() + ": " + arguments.last().toLocal8Bit() + "\n";
+            if (! writeFile(depFileName, rule))
+                return 1;
+        }
+        return 0;
+    }
+
+    // link
+    foreach (const QString &argument, arguments)
+    {
+        if (argument.startsWith("-Wl,-Map,") && ! writeFile(argument.mid(9), QByteArray()))
+            return 1;
+    }
+    return writeFile(output, elfImage()) ? 0 : 1;
+}
+
+bool StubToolchain::install(const QString &directory)
+{
+    if (! QDir().mkpath(directory))
+        return false;
+
+    QString executable = QCoreApplication::applicationFilePath();
+    for (size_t i = 0; i < sizeof(stubTools) / sizeof(stubTools[0]); i++)
+    {
+        QString tool = QDir(directory).filePath(stubTools[i]);
+#if defined(Q_OS_WIN32) || defined(Q_OS_WIN64)
+        // shortcuts can't be executed, copy the executable
+        tool += ".exe";
+        QFile::remove(tool);
+        if (! QFile::copy(executable, tool))
+            return false;
+#else
+        QFile::remove(tool);
+        if (! QFile::link(executable, tool))
+            return false;
+#endif
+    }
+    return true;
+}
+
+QByteArray StubToolchain::elfImage()
+{
+    // ELF header, .text, section names, then the section headers: null,
+    // .text and .shstrtab
+    static const char names[] = "\0.text\0.shstrtab";
+    const quint32 textOffset = 52;
+    const quint32 namesOffset = textOffset + stubTextSize;
+    const quint32 sectionsOffset = (namesOffset + sizeof(names) + 3) & ~3;
+
+    QByteArray elf(sectionsOffset + 3 * 40, '\0');
+    elf[0] = 0x7f;
+    elf[1] = 'E';
+    elf[2] = 'L';
+    elf[3] = 'F';
+    elf[4] = 1; // 32 bits
+    elf[5] = 1; // little-endian
+    elf[6] = 1; // version
+    put16(elf, 16, 2); // executable
+    put16(elf, 18, 83); // AVR
+    put32(elf, 20, 1);
+    put32(elf, 32, sectionsOffset);
+    put16(elf, 40, 52);
+    put16(elf, 42, 32);
+    put16(elf, 46, 40);
+    put16(elf, 48, 3);
+    put16(elf, 50, 2);
+
+    memcpy(elf.data() + namesOffset, names, sizeof(names));
+
+    int text = sectionsOffset + 40;
+    put32(elf, text, 1);
+    put32(elf, text + 4, 1); // PROGBITS
+    put32(elf, text + 8, 6); // ALLOC | EXECINSTR
+    put32(elf, text + 16, textOffset);
+    put32(elf, text + 20, stubTextSize);
+    put32(elf, text + 32, 2);
+
+    int shstrtab = sectionsOffset + 80;
+    put32(elf, shstrtab, 7);
+    put32(elf, shstrtab + 4, 3); // STRTAB
+    put32(elf, shstrtab + 16, namesOffset);
+    put32(elf, shstrtab + 20, sizeof(names));
+    put32(elf, shstrtab + 32, 1);
+
+    return elf;
+}
+
+bool StubToolchain::writeFile(const QString &fileName, const QByteArray &contents)
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::WriteOnly))
+    {
+        fprintf(stderr, "cannot write %s\n", fileName.toLocal8Bit().constData());
+        return false;
+    }
+    return file.write(contents) == contents.size();
+}
@@ -0,0 +1,88 @@
+/*
+  StubToolchain.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file StubToolchain.h
+ * \author Denis Martinez
+ */
+
+#ifndef STUBTOOLCHAIN_H
+#define STUBTOOLCHAIN_H
+
+#include <QString>
+
+/**
+ * @brief Fake AVR toolchain, to measure the builder without the real compilers
+ *
+ * The tools are links to the IDE executable, which behaves as a tool when
+ * started under the name of one: the compilers write empty objects and
+ * dependency files, the linker a small ELF file and the archiver an empty
+ * archive. Each tool waits for ARDUIDE_STUB_DELAY milliseconds, if set.
+ */
+class StubToolchain
+{
+public:
+    /**
+     * @brief Check whether the executable was started as a stub tool
+     *
+     * @param argv0 Name of the executable
+     * @return bool
+     */
+    static bool isInvoked(const char *argv0);
+
+    /**
+     * @brief Behave as the tool the executable was started as
+     *
+     * @param argc Number of arguments
+     * @param argv Arguments
+     * @return int, the exit code of the tool
+     */
+    static int run(int argc, char **argv);
+
+    /**
+     * @brief Create the stub tools in a directory
+     *
+     * @param directory Directory, given to Toolkit::setAvrPath()
+     * @return bool, True if success or False if not
+     */
+    static bool install(const QString &directory);
+
+private:
+    /**
+     * @brief Return a minimal linked sketch
+     *
+     * @return QByteArray, an ELF file with a .text section
+     */
+    static QByteArray elfImage();
+
+    /**
+     * @brief Write a file
+     *
+     * @param fileName File name
+     * @param contents Contents
+     * @return bool, True if success or False if not
+     */
+    static bool writeFile(const QString &fileName, const QByteArray &contents);
+};
+
+#endif // STUBTOOLCHAIN_H
@@ -32,11 +32,143 @@ This program is free software; you can redistribute it and/or modify
 #include <QDir>
 #include <QFile>
 #include <QProcess>
+#include <QRegExp>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QDebug>
 
 #include "Board.h"
+#include "BuildCache.h"
 #include "IDEApplication.h"
 
+QString Toolkit::mAvrPath;
+
+// names of the tools, in the order of Toolkit::AVRTool
+static const char *avrToolNames[] = { "avr-gcc", "avr-g++", "avr-ar", "avr-gcc-ar", "avr-objcopy", "avr-size" };
+
+// the context, valid until invalidateContext() is called
+static QMutex contextMutex;
+static bool contextValid = false;
+
+// versions of avrdude, by path, also forgotten by invalidateContext()
+static QMutex avrdudeMutex;
+static QHash<QString, QString> avrdudeVersions;
+
+struct Toolkit::Context
+{
+    QString arduinoPath;
+    QString version;
+    int versionInt;
+    QString hardwarePath;
+    QString avrPath;
+    QStringList tools;
+    QString libraryPath;
+    QString userLibraryPath;
+    QString IDELibraryPath;
+    QStringList boardsFileNames;
+    QString systemAvrdude;
+};
+
+void Toolkit::invalidateContext()
+{
+    {
+        QMutexLocker locker(&contextMutex);
+        contextValid = false;
+    }
+    QMutexLocker locker(&avrdudeMutex);
+    avrdudeVersions.clear();
+}
+
+Toolkit::Context Toolkit::context()
+{
+    static Context current;
+
+    QMutexLocker locker(&contextMutex);
+    if (! contextValid)
+    {
+        current = resolveContext();
+        contextValid = true;
+    }
+    return current;
+}
+
+Toolkit::Context Toolkit::resolveContext()
+{
+    Settings *settings = ideApp->settings();
+    Context context;
+    context.arduinoPath = settings->arduinoPath();
+    context.version = readToolkitVersion(context.arduinoPath);
+    context.versionInt = QString(context.version).remove('.').toInt();
+    context.hardwarePath = QDir(context.arduinoPath).filePath("hardware");
+
+    if (! mAvrPath.isNull())
+        context.avrPath = mAvrPath;
+    else if (context.versionInt >= 160)
+        context.avrPath = QDir(context.hardwarePath).filePath("/hardware/tools/avr/bin");
+    else if (context.versionInt >= 100)
+        context.avrPath = QDir(context.hardwarePath).filePath("tools/avr/bin");
+    // else the AVR toolchain should be already present in the PATH
+
+    // the tools missing from the directory are looked up in the PATH
+    for (size_t i = 0; i < sizeof(avrToolNames) / sizeof(avrToolNames[0]); i++)
+    {
+        QString toolName = avrToolNames[i];
+        QString toolPath = QDir(context.avrPath).filePath(toolName);
+        if (QFile::exists(toolPath) || QFile::exists(toolPath + ".exe"))
+            context.tools << toolPath;
+        else
+            context.tools << toolName;
+    }
+
+    context.libraryPath = QDir(context.arduinoPath).filePath("libraries");
+    context.userLibraryPath = QDir(settings->sketchPath()).filePath("libraries");
+    context.IDELibraryPath = QDir(ideApp->dataPath()).filePath("libraries");
+
+    if (context.versionInt >= 160)
+        context.boardsFileNames << QDir(context.hardwarePath).filePath("arduino/avr/boards.txt");
+    else
+        context.boardsFileNames << QDir(context.hardwarePath).filePath("arduino/boards.txt");
+
+    QDir sketchDir = QDir(settings->sketchPath());
+    if (sketchDir.cd("hardware"))
+    {
+        sketchDir.setFilter(QDir::AllDirs);
+        QStringList hwList = sketchDir.entryList();
+        foreach(QString dir, hwList)
+        {
+            if (QDir(sketchDir.filePath(dir)).exists("boards.txt"))
+                context.boardsFileNames.push_back(sketchDir.filePath(dir + "/boards.txt"));
+        }
+    }
+
+    context.systemAvrdude = findInPath("avrdude");
+
+    return context;
+}
+
+QString Toolkit::findInPath(const QString &program)
+{
+#if defined(Q_OS_WIN32) || defined(Q_OS_WIN64)
+    static const QChar separator = ';';
+    static const QStringList suffixes = QStringList() << ".exe";
+#else
+    static const QChar separator = ':';
+    static const QStringList suffixes = QStringList() << QString();
+#endif
+
+    foreach (const QString &directory, QString::fromLocal8Bit(qgetenv("PATH")).split(separator, QString::SkipEmptyParts))
+    {
+        foreach (const QString &suffix, suffixes)
+        {
+            QFileInfo info(QDir(directory).filePath(program + suffix));
+            if (info.isFile() && info.isExecutable())
+                return info.absoluteFilePath();
+        }
+    }
+    return QString();
+}
+
 QStringList Toolkit::findSketchesInDirectory(const QString &directory)
 {
     QStringList sketches;
@@ -88,30 +220,12 @@ QString Toolkit::referencePath()
 
 QString Toolkit::hardwarePath()
 {
-    return QDir(ideApp->settings()->arduinoPath()).filePath("hardware");
+    return context().hardwarePath;
 }
 
 QStringList Toolkit::boardsFileNames()
 {
-    QStringList userHwList;
-    if(toolkitVersionInt(ideApp->settings()->arduinoPath()) >= 160)
-        userHwList << QDir(hardwarePath()).filePath("arduino/avr/boards.txt");
-    else
-        userHwList << QDir(hardwarePath()).filePath("arduino/boards.txt");
-
-    QDir sketchDir = QDir(ideApp->settings()->sketchPath());
-    if (sketchDir.cd("hardware"))
-    {
-        sketchDir.setFilter(QDir::AllDirs);
-        QStringList hwList = sketchDir.entryList();
-        foreach(QString dir, hwList)
-        {
-            if (QDir(sketchDir.filePath(dir)).exists("boards.txt"))
-                userHwList.push_back(sketchDir.filePath(dir + "/boards.txt"));
-        }
-    }
-
-    return userHwList;
+    return context().boardsFileNames;
 }
 
 QString Toolkit::keywordsFileName()
@@ -120,6 +234,14 @@ QString Toolkit::keywordsFileName()
 }
 
 QString Toolkit::toolkitVersion(const QString &path)
+{
+    Context current = context();
+    if (path == current.arduinoPath)
+        return current.version;
+    return readToolkitVersion(path);
+}
+
+QString Toolkit::readToolkitVersion(const QString &path)
 {
     if(QFileInfo(QDir(path).filePath("hardware/arduino/boards.txt")).isReadable() || (QFileInfo(QDir(path).filePath("hardware/arduino/avr/boards.txt")).isReadable() && QFileInfo(QDir(path).filePath("hardware/arduino/sam/boards.txt")).isReadable()))
     {
@@ -151,61 +273,73 @@ bool Toolkit::isValidArduinoPath(const QString &path)
 
 QString Toolkit::avrPath()
 {
-#if defined(Q_OS_WIN32) || defined(Q_OS_WIN64) || defined(Q_OS_DARWIN)
-    if(toolkitVersionInt(ideApp->settings()->arduinoPath()) >= 160)
-        return QDir(hardwarePath()).filePath("/hardware/tools/avr/bin");
-    else if (toolkitVersionInt(ideApp->settings()->arduinoPath()) >= 100)
-        return QDir(hardwarePath()).filePath("tools/avr/bin");
-#else
-    if(toolkitVersionInt(ideApp->settings()->arduinoPath()) >= 160)
-        return QDir(hardwarePath()).filePath("/hardware/tools/avr/bin");
-    else if (toolkitVersionInt(ideApp->settings()->arduinoPath()) >= 100)
-        return QDir(hardwarePath()).filePath("tools/avr/bin");
-    else {
-        // the AVR toolchain should be already present in the PATH
-        return QString();
-    }
-#endif
+    return context().avrPath;
+}
+
+void Toolkit::setAvrPath(const QString &path)
+{
+    mAvrPath = path;
+    invalidateContext();
 }
 
 QString Toolkit::avrTool(Toolkit::AVRTool tool)
 {
-    QString path = avrPath();
-    QString toolName;
-    switch (tool)
+    return context().tools.value(tool);
+}
+
+QStringList Toolkit::buildProfiles()
+{
+    static const QStringList profiles = QStringList() << "size" << "speed" << "lto" << "debug";
+    return profiles;
+}
+
+QString Toolkit::defaultBuildProfile()
+{
+    return buildProfiles().first();
+}
+
+QString Toolkit::buildProfileDescription(const QString &profile)
+{
+    if (profile == "size")
+        return QObject::tr("Optimize for size");
+    else if (profile == "speed")
+        return QObject::tr("Optimize for speed");
+    else if (profile == "lto")
+        return QObject::tr("Optimize for size, at link time too");
+    else if (profile == "debug")
+        return QObject::tr("Optimize for debugging");
+    return QString();
+}
+
+QStringList Toolkit::optimizationFlags(const QString &profile)
+{
+    QStringList flags;
+    if (profile == "speed")
+        flags << "-O2";
+    else if (profile == "lto")
+        flags << "-Os" << "-flto";
+    else if (profile == "debug")
     {
-    case AvrGcc:
-        toolName = "avr-gcc";
-        break;
-    case AvrGxx:
-        toolName = "avr-g++";
-        break;
-    case AvrAr:
-        toolName = "avr-ar";
-        break;
-    case AvrObjcopy:
-        toolName = "avr-objcopy";
-        break;
-    case AvrSize:
-        toolName = "avr-size";
-        break;
-    default:
-        return QString();
+        // -Og appeared in GCC 4.8
+        QList<QByteArray> version = BuildCache::toolchainVersion(avrTool(AvrGcc)).split('.');
+        int major = version.value(0).toInt();
+        int minor = version.value(1).toInt();
+        if (major > 4 || (major == 4 && minor >= 8))
+            flags << "-Og";
+        else
+            flags << "-O1";
     }
-
-    QString toolPath = QDir(path).filePath(toolName);
-    if (QFile::exists(toolPath))
-	return toolPath;
     else
-        return toolName;
+        flags << "-Os";
+    return flags;
 }
 
-QStringList Toolkit::avrCFlags(const Board *board)
+QStringList Toolkit::avrCFlags(const Board *board, const QString &profile)
 {
     QStringList cflags;
     cflags
         << "-g"
-        << "-Os"
+        << optimizationFlags(profile)
         << "-Wall"
         << "-fno-exceptions"
         << "-ffunction-sections"
@@ -213,7 +347,7 @@ QStringList Toolkit::avrCFlags(const Board *board)
         << QString("-mmcu=%0").arg(board->selectedMcu())
         << QString("-DF_CPU=%0").arg(board->selectedFreq())
         << QString("-MMD")
-        << QString("-DARDUINO=%0").arg(toolkitVersionInt(ideApp->settings()->arduinoPath()));
+        << QString("-DARDUINO=%0").arg(context().versionInt);
 
     if (!board->attribute("build.vid").isEmpty())
         cflags << QString("-DUSB_VID=%0").arg(board->attribute("build.vid"));
@@ -225,22 +359,16 @@ QStringList Toolkit::avrCFlags(const Board *board)
     else
         cflags << QString("-DUSB_PID=null");
 
-    QString arduinoPinDirName;
-    if(toolkitVersionInt(ideApp->settings()->arduinoPath()) >= 160)
-        arduinoPinDirName = QString("arduino/avr/variants/%0").arg(board->attribute("build.variant"));
-    else
-        arduinoPinDirName = QString("arduino/variants/%0").arg(board->attribute("build.variant"));
-
-    QString arduinoPinDirPath = QDir(hardwarePath()).filePath(arduinoPinDirName);
-    if (QDir(arduinoPinDirPath).exists())
+    QString arduinoPinDirPath = variantPath(board);
+    if (! arduinoPinDirPath.isEmpty())
         cflags << QString("-I%0").arg(arduinoPinDirPath);
 
     return cflags;
 }
 
-QStringList Toolkit::avrCxxFlags(const Board *board)
+QStringList Toolkit::avrCxxFlags(const Board *board, const QString &profile)
 {
-    return avrCFlags(board);
+    return avrCFlags(board, profile);
 }
 
 QStringList Toolkit::avrSFlags(const Board *board)
@@ -252,31 +380,40 @@ QStringList Toolkit::avrSFlags(const Board *board)
         << QString("-mmcu=%0").arg(board->selectedMcu())
         << QString("-MMD")
         << QString("-DF_CPU=%0").arg(board->selectedFreq())
-        << QString("-DARDUINO=%0").arg(toolkitVersionInt(ideApp->settings()->arduinoPath()));
+        << QString("-DARDUINO=%0").arg(context().versionInt);
     return sflags;
 }
 
-QStringList Toolkit::avrLdFlags(const Board *board)
+QStringList Toolkit::avrLdFlags(const Board *board, const QString &profile)
 {
+    // the link-time optimizer runs with the flags of the link
     QStringList ldflags;
     ldflags
-        << "-Os"
+        << optimizationFlags(profile)
         << "-Wl,--gc-sections"
         << QString("-mmcu=%0").arg(board->selectedMcu());
+    if (profile == "lto")
+        ldflags << "-fuse-linker-plugin";
     return ldflags;
 }
 
-QStringList Toolkit::avrSizeFlags(const Board *board)
+QString Toolkit::corePath(const Board *board)
 {
-    QStringList sizeflags;
-    sizeflags
-        << "-t";
-    return sizeflags;
+    return QDir(board->hardwarePath()).filePath(QString("cores/%0").arg(board->attribute("build.core")));
 }
 
-QString Toolkit::corePath(const Board *board)
+QString Toolkit::variantPath(const Board *board)
 {
-    return QDir(board->hardwarePath()).filePath(QString("cores/%0").arg(board->attribute("build.core")));
+    QString arduinoPinDirName;
+    if(context().versionInt >= 160)
+        arduinoPinDirName = QString("arduino/avr/variants/%0").arg(board->attribute("build.variant"));
+    else
+        arduinoPinDirName = QString("arduino/variants/%0").arg(board->attribute("build.variant"));
+
+    QString arduinoPinDirPath = QDir(hardwarePath()).filePath(arduinoPinDirName);
+    if (QDir(arduinoPinDirPath).exists())
+        return arduinoPinDirPath;
+    return QString();
 }
 
 QStringList Toolkit::IDELibraries()
@@ -301,19 +438,19 @@ QStringList Toolkit::libraries()
 
 QString Toolkit::IDELibraryPath()
 {
-    return QDir(ideApp->dataPath()).filePath("libraries");
+    return context().IDELibraryPath;
 }
 
 QString Toolkit::userLibraryPath()
 {
-    return QDir(ideApp->settings()->sketchPath()).filePath("libraries");
+    return context().userLibraryPath;
 }
 
 QString Toolkit::libraryPath(const QString &libraryName)
 {
     if (libraryName.isNull())
     {
-        return QDir(ideApp->settings()->arduinoPath()).filePath(QString("libraries"));
+        return context().libraryPath;
     }
     else
     {
@@ -373,10 +510,11 @@ QString Toolkit::avrdudePath()
 #if defined(Q_OS_WIN32) || defined(Q_OS_WIN64) || defined(Q_OS_DARWIN)
     return QDir(hardwarePath()).filePath("tools/avr/bin/avrdude");
 #else
-    if(avrdudeSystem())
-      return(QString("avrdude"));
+    QString path = context().systemAvrdude;
+    if (! path.isEmpty())
+        return path;
     else
-      return QDir(hardwarePath()).filePath("tools/avrdude");
+        return QDir(hardwarePath()).filePath("tools/avrdude");
 #endif
 }
 
@@ -404,11 +542,30 @@ QStringList Toolkit::avrdudeFlags(const Board *board)
 
 bool Toolkit::avrdudeSystem()
 {
-  QProcess proc;
+    return ! context().systemAvrdude.isEmpty();
+}
 
-  proc.start(QString("avrdude"));
-  if(proc.waitForStarted())
-    return true;
+QString Toolkit::avrdudeVersion()
+{
+    QString path = avrdudePath();
+    QMutexLocker locker(&avrdudeMutex);
+    QHash<QString, QString>::const_iterator it = avrdudeVersions.constFind(path);
+    if (it != avrdudeVersions.constEnd())
+        return *it;
 
-  return false;
+    // avrdude prints its version, then fails for lack of a part
+    QString version;
+    QProcess proc;
+    proc.setProcessChannelMode(QProcess::MergedChannels);
+    proc.start(path, QStringList() << "-v");
+    if (proc.waitForFinished())
+    {
+        QRegExp pattern("version:?\\s+([^\\s,]+)", Qt::CaseInsensitive);
+        if (pattern.indexIn(QString::fromLocal8Bit(proc.readAll())) >= 0)
+            version = pattern.cap(1);
+    }
+    else
+        proc.kill();
+    avrdudeVersions.insert(path, version);
+    return version;
 }
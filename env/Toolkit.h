@@ -99,6 +99,9 @@ public:
     /**
      * @brief Return version of toolkit
      *
+     * The version of the SDK of the settings is only read once, see
+     * invalidateContext().
+     *
      * @param path toolkit path
      * @return QString
      */
@@ -127,11 +130,33 @@ public:
      */
     static QString avrPath();
 
+    /**
+     * @brief Use the AVR tools of another directory than the SDK
+     *
+     * Used by the benchmarks to run a stub toolchain.
+     *
+     * @param path Directory of the tools, or a null string to use the SDK again
+     * @return void
+     */
+    static void setAvrPath(const QString &path);
+
+    /**
+     * @brief Forget the paths and versions resolved from the settings
+     *
+     * The SDK version, the tools, the hardware and library directories are
+     * resolved once, then reused by every build until this is called. The
+     * settings call it when the Arduino or sketchbook path changes.
+     *
+     * @return void
+     */
+    static void invalidateContext();
+
     enum AVRTool
     {
         AvrGcc,
         AvrGxx,
         AvrAr,
+        AvrGccAr,
         AvrObjcopy,
         AvrSize
     };
@@ -144,21 +169,48 @@ public:
      */
     static QString avrTool(AVRTool tool);
 
+    /**
+     * @brief Return the build profiles, the default one first
+     *
+     * A profile selects how the sketch is optimized: "size", "speed", "lto"
+     * (size, with link-time optimization) or "debug".
+     *
+     * @return QStringList
+     */
+    static QStringList buildProfiles();
+
+    /**
+     * @brief Return the profile used when none is selected
+     *
+     * @return QString
+     */
+    static QString defaultBuildProfile();
+
+    /**
+     * @brief Return a short description of a build profile, for the user
+     *
+     * @param profile Build profile
+     * @return QString
+     */
+    static QString buildProfileDescription(const QString &profile);
+
     /**
      * @brief Return C flags of board
      *
      * @param board Board
+     * @param profile Build profile, the default one if empty
      * @return QStringList
      */
-    static QStringList avrCFlags(const Board *board);
+    static QStringList avrCFlags(const Board *board, const QString &profile = QString());
 
     /**
      * @brief Return c++ flags of board
      *
      * @param board Board
+     * @param profile Build profile, the default one if empty
      * @return QStringList
      */
-    static QStringList avrCxxFlags(const Board *board);
+    static QStringList avrCxxFlags(const Board *board, const QString &profile = QString());
 
     /**
      * @brief Return S flags
@@ -171,26 +223,29 @@ public:
     /**
      * @brief Return LD flags
      *
+     * The unused sections are always garbage-collected.
+     *
      * @param board Board
+     * @param profile Build profile, the default one if empty
      * @return QStringList
      */
-    static QStringList avrLdFlags(const Board *board);
+    static QStringList avrLdFlags(const Board *board, const QString &profile = QString());
 
     /**
-     * @brief Return avr-size flags
+     * @brief Return core path
      *
      * @param board Board
-     * @return QStringList
+     * @return QString
      */
-    static QStringList avrSizeFlags(const Board *board);
+    static QString corePath(const Board *board);
 
     /**
-     * @brief Return core path
+     * @brief Return variant path, where pins_arduino.h is found
      *
      * @param board Board
-     * @return QString
+     * @return QString, empty if the board has no variant
      */
-    static QString corePath(const Board *board);
+    static QString variantPath(const Board *board);
 
     /**
      * @brief Return the IDE LIbraries
@@ -290,11 +345,76 @@ public:
     static QStringList avrdudeFlags(const Board *board);
 
     /**
-     * @brief Run avrdude
+     * @brief Return the version of avrdude
+     *
+     * avrdude is only run the first time, the version is then kept until
+     * the context is invalidated.
+     *
+     * @return QString, empty if unknown
+     */
+    static QString avrdudeVersion();
+
+    /**
+     * @brief Return whether avrdude is installed in the PATH
+     *
+     * The PATH is searched once per context, see invalidateContext().
      *
-     * @return bool, Return True if success
+     * @return bool, Return True if found
      */
     static bool avrdudeSystem();
+
+private:
+    /**
+     * @brief Paths and versions resolved from the settings
+     *
+     */
+    struct Context;
+
+    /**
+     * @brief Return the current context, resolving it if needed
+     *
+     * Can be called from any thread.
+     *
+     * @return Toolkit::Context
+     */
+    static Context context();
+
+    /**
+     * @brief Resolve the context from the settings
+     *
+     * @return Toolkit::Context
+     */
+    static Context resolveContext();
+
+    /**
+     * @brief Search the PATH for a program
+     *
+     * @param program Program name, without extension
+     * @return QString, the absolute path of the program or empty if not found
+     */
+    static QString findInPath(const QString &program);
+
+    /**
+     * @brief Read the version of the SDK installed in a directory
+     *
+     * @param path toolkit path
+     * @return QString, empty if not an SDK
+     */
+    static QString readToolkitVersion(const QString &path);
+
+    /**
+     * @brief Return the optimization flags of a build profile, for the compiler and the linker
+     *
+     * @param profile Build profile, the default one if empty
+     * @return QStringList
+     */
+    static QStringList optimizationFlags(const QString &profile);
+
+    /**
+     * @brief Directory set by setAvrPath(), if any
+     *
+     */
+    static QString mAvrPath;
 };
 
 #endif // TOOLKIT_H
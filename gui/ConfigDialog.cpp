@@ -96,6 +96,9 @@ void ConfigWidget::resetPage(int index)
     case BuildIndex:
         uiBuild.verboseBox->setChecked(settings->verboseUpload());
         uiBuild.filterDevicesBox->setChecked(settings->filterSerialDevices());
+        uiBuild.jobsSpin->setValue(settings->buildJobs());
+        uiBuild.timingBox->setChecked(settings->buildTiming());
+        uiBuild.syntaxCheckBox->setChecked(settings->syntaxCheck());
         break;
     }
 }
@@ -149,6 +152,9 @@ void ConfigWidget::setupUi()
     connect(uiPaths.sketchbookPathEdit, SIGNAL(textChanged(const QString &)), this, SLOT(fieldChange()));
     connect(uiBuild.verboseBox, SIGNAL(stateChanged(int)), this, SLOT(fieldChange()));
     connect(uiBuild.filterDevicesBox, SIGNAL(stateChanged(int)), this, SLOT(fieldChange()));
+    connect(uiBuild.jobsSpin, SIGNAL(valueChanged(int)), this, SLOT(fieldChange()));
+    connect(uiBuild.timingBox, SIGNAL(stateChanged(int)), this, SLOT(fieldChange()));
+    connect(uiBuild.syntaxCheckBox, SIGNAL(stateChanged(int)), this, SLOT(fieldChange()));
 
     connect(uiEditor.fontChooseButton, SIGNAL(clicked()), this, SLOT(chooseFont()));
     connect(uiEditor.colorBox, SIGNAL(currentIndexChanged(int)), this, SLOT(setColorAtIndex(int)));
@@ -278,6 +284,12 @@ bool ConfigWidget::saveConfig()
             settings->setVerboseUpload(uiBuild.verboseBox->isChecked());
         else if (field == uiBuild.filterDevicesBox)
             settings->setFilterDevices(uiBuild.filterDevicesBox->isChecked());
+        else if (field == uiBuild.jobsSpin)
+            settings->setBuildJobs(uiBuild.jobsSpin->value());
+        else if (field == uiBuild.timingBox)
+            settings->setBuildTiming(uiBuild.timingBox->isChecked());
+        else if (field == uiBuild.syntaxCheckBox)
+            settings->setSyntaxCheck(uiBuild.syntaxCheckBox->isChecked());
     }
     mChangedFields.clear();
 
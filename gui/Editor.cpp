@@ -34,6 +34,7 @@ This program is free software; you can redistribute it and/or modify
 #include <QShortcut>
 #include <QDebug>
 #include <Qsci/qscilexer.h>
+#include <Qsci/qscistyle.h>
 
 #include "env/Settings.h"
 #include "IDEApplication.h"
@@ -42,6 +43,7 @@ Editor::Editor(QWidget *parent)
     : QsciScintilla(parent)
 {
     setupShortcuts();
+    setupDiagnostics();
 
     connect(this, SIGNAL(selectionChanged()), this, SLOT(updateSelectionOrigin()));
 }
@@ -83,6 +85,76 @@ void Editor::setupShortcuts()
     addCustomShortcut(QKeySequence("Ctrl+Shift+Down"), this, SLOT(selectTillNextParagraph()));
 }
 
+void Editor::setupDiagnostics()
+{
+    mErrorMarker = markerDefine(QsciScintilla::Circle);
+    setMarkerBackgroundColor(Qt::red, mErrorMarker);
+    setMarkerForegroundColor(Qt::darkRed, mErrorMarker);
+    mWarningMarker = markerDefine(QsciScintilla::Circle);
+    setMarkerBackgroundColor(QColor(255, 190, 0), mWarningMarker);
+    setMarkerForegroundColor(QColor(160, 110, 0), mWarningMarker);
+
+    // the line numbers are in margin 1, keep margin 0 for the markers
+    setMarginType(0, QsciScintilla::SymbolMargin);
+    setMarginMarkerMask(0, (1 << mErrorMarker) | (1 << mWarningMarker));
+    setMarginWidth(0, 14);
+    setAnnotationDisplay(QsciScintilla::AnnotationBoxed);
+}
+
+// the styles are allocated once and shared by all the editors
+static const QsciStyle &annotationStyle(Diagnostic::Severity severity)
+{
+    static const QsciStyle errorStyle(-1, "Error annotation", Qt::darkRed, QColor(255, 225, 225), QFont());
+    static const QsciStyle warningStyle(-1, "Warning annotation", QColor(120, 80, 0), QColor(255, 245, 210), QFont());
+    static const QsciStyle noteStyle(-1, "Note annotation", Qt::darkGray, QColor(240, 240, 240), QFont());
+    switch (severity)
+    {
+    case Diagnostic::Error:
+        return errorStyle;
+    case Diagnostic::Warning:
+        return warningStyle;
+    default:
+        return noteStyle;
+    }
+}
+
+void Editor::addDiagnostic(const Diagnostic &diagnostic)
+{
+    if (! diagnostic.inSketch || diagnostic.line < 1 || diagnostic.line > lines())
+        return;
+
+    int line = diagnostic.line - 1;
+    Diagnostic::Severity severity = diagnostic.severity;
+    if (severity == Diagnostic::Error)
+    {
+        markerDelete(line, mWarningMarker);
+        markerAdd(line, mErrorMarker);
+    }
+    else if (severity == Diagnostic::Warning && ! (markersAtLine(line) & (1 << mErrorMarker)))
+        markerAdd(line, mWarningMarker);
+
+    // several diagnostics on the same line share the annotation, which
+    // takes the style of the most severe one
+    QString text = diagnostic.message;
+    QString previous = annotation(line);
+    if (! previous.isEmpty())
+    {
+        text = previous + "\n" + text;
+        if (markersAtLine(line) & (1 << mErrorMarker))
+            severity = Diagnostic::Error;
+        else if (markersAtLine(line) & (1 << mWarningMarker))
+            severity = Diagnostic::Warning;
+    }
+    annotate(line, text, annotationStyle(severity));
+}
+
+void Editor::clearDiagnostics()
+{
+    markerDeleteAll(mErrorMarker);
+    markerDeleteAll(mWarningMarker);
+    clearAnnotations();
+}
+
 bool Editor::addCustomShortcut(const QKeySequence &key, QObject *receiver, const char *slot)
 {
     foreach (const EditorShortcut &sc, mCustomShortcuts)
@@ -31,6 +31,7 @@ This program is free software; you can redistribute it and/or modify
 
 #include <Qsci/qsciscintilla.h>
 
+#include "env/Diagnostic.h"
 #include "IDEGlobal.h"
 
 class QShortcut;
@@ -59,8 +60,26 @@ public slots:
     void save(bool saveas);
     void showContextualHelp();
 
+    /**
+     * @brief Show a diagnostic of the sketch in the margin and below its line
+     *
+     * Diagnostics located outside of the sketch are ignored.
+     *
+     * @param diagnostic Diagnostic
+     * @return void
+     */
+    void addDiagnostic(const Diagnostic &diagnostic);
+
+    /**
+     * @brief Remove the diagnostics of the previous build
+     *
+     * @return void
+     */
+    void clearDiagnostics();
+
 private:
     void setupShortcuts();
+    void setupDiagnostics();
 
     QString mFileName;
     struct
@@ -80,6 +99,8 @@ private:
     QColor mCaretForegroundColor, mSelectionBackgroundColor;
     int mCaretWidth;
 
+    int mErrorMarker, mWarningMarker;
+
 private slots:
     void findPreviousParagraph(int *line, int *index);
     void findNextParagraph(int *line, int *index);
@@ -39,6 +39,7 @@ This program is free software; you can redistribute it and/or modify
 #include <QDesktopServices>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QTimer>
 
 #include "EditorFactory.h"
 #include "LexerArduino.h"
@@ -56,8 +57,11 @@ This program is free software; you can redistribute it and/or modify
 
 #include "ui_AboutDialog.h"
 
+// idle time before the sketch is checked, in ms
+static const int syntaxCheckDelay = 800;
+
 MainWindow::MainWindow()
-    : QMainWindow(), configDialog(NULL)
+    : QMainWindow(), backgroundBuilder(NULL), syntaxChecker(NULL), syntaxCheckTimer(NULL), configDialog(NULL)
 {
     ui.setupUi(this);
     refreshTitle();
@@ -75,6 +79,7 @@ void MainWindow::initialize()
 
     createDeviceChooser();
     createBoardChooser();
+    createProfileChooser();
 
     setupActions();
 
@@ -92,6 +97,27 @@ void MainWindow::setupActions()
     buildActions->addAction(ui.action_Build);
     buildActions->addAction(ui.action_Upload);
 
+    // a single builder, so that a new build supersedes the running one
+    backgroundBuilder = new BackgroundBuilder(this);
+    connect(backgroundBuilder, SIGNAL(buildFinished(bool)), this, SIGNAL(buildFinished(bool)));
+    connect(backgroundBuilder, SIGNAL(uploadFinished(bool)), this, SIGNAL(uploadFinished(bool)));
+    connect(backgroundBuilder, SIGNAL(log(QString)), ui.outputView, SLOT(log(QString)));
+    connect(backgroundBuilder, SIGNAL(logError(QString)), ui.outputView, SLOT(logError(QString)));
+    connect(backgroundBuilder, SIGNAL(logImportant(QString)), ui.outputView, SLOT(logImportant(QString)));
+    connect(backgroundBuilder, SIGNAL(logCommand(QStringList)), ui.outputView, SLOT(logCommand(QStringList)));
+    connect(backgroundBuilder, SIGNAL(diagnosticFound(Diagnostic)), this, SLOT(addBuildDiagnostic(Diagnostic)));
+    connect(backgroundBuilder, SIGNAL(phaseFinished(QString, qint64)), this, SLOT(logBuildPhase(QString, qint64)));
+    connect(backgroundBuilder, SIGNAL(runningChanged(bool)), ui.action_Stop, SLOT(setEnabled(bool)));
+    ui.action_Stop->setEnabled(false);
+
+    // checks run once the editor stayed idle for a while
+    syntaxChecker = new BackgroundBuilder(this);
+    syntaxCheckTimer = new QTimer(this);
+    syntaxCheckTimer->setSingleShot(true);
+    syntaxCheckTimer->setInterval(syntaxCheckDelay);
+    connect(syntaxCheckTimer, SIGNAL(timeout()), this, SLOT(checkSyntax()));
+    connect(syntaxChecker, SIGNAL(checkFinished(bool, QList<Diagnostic>)), this, SLOT(syntaxChecked(bool, QList<Diagnostic>)));
+
     connect(ui.tabWidget, SIGNAL(tabCloseRequested(int)), this, SLOT(closeTab(int)));
     connect(ui.tabWidget, SIGNAL(currentChanged(int)), this, SLOT(tabHasChanged()));
     connect(ui.action_New, SIGNAL(triggered()), this, SLOT(newProject()));
@@ -108,6 +134,7 @@ void MainWindow::setupActions()
     connect(ui.action_Paste, SIGNAL(triggered()), this, SLOT(paste()));
     connect(ui.action_Build, SIGNAL(triggered()), this, SLOT(build()));
     connect(ui.action_Upload, SIGNAL(triggered()), this, SLOT(upload()));
+    connect(ui.action_Stop, SIGNAL(triggered()), backgroundBuilder, SLOT(cancel()));
     connect(ui.action_Utilities, SIGNAL(triggered()), this, SLOT(toggleDock()));
     connect(ui.actionGo_to_the_next_tab, SIGNAL(triggered()), this, SLOT(nextTab()));
     connect(ui.actionGo_to_the_previous_tab, SIGNAL(triggered()), this, SLOT(previousTab()));
@@ -217,6 +244,28 @@ void MainWindow::chooseBoard()
     boardChooser->exec(QPoint(x, y));
 }
 
+void MainWindow::createProfileChooser()
+{
+    profileBox = new QComboBox(this);
+    profileBox->setToolTip(tr("Build profile of the sketch"));
+    foreach (const QString &profile, Toolkit::buildProfiles())
+    {
+        profileBox->addItem(profile);
+        profileBox->setItemData(profileBox->count() - 1, Toolkit::buildProfileDescription(profile), Qt::ToolTipRole);
+    }
+    ui.deviceToolBar->addWidget(profileBox);
+    connect(profileBox, SIGNAL(activated(int)), this, SLOT(setBuildProfile(int)));
+}
+
+void MainWindow::setBuildProfile(int index)
+{
+    Editor *editor = currentEditor();
+    if (editor == NULL || index < 0)
+        return;
+
+    ideApp->settings()->setBuildProfile(editor->fileName(), Toolkit::buildProfiles().at(index));
+}
+
 void MainWindow::newProject(const QString &code, const QString &name, Editor **pEditor)
 {
     Editor *editor;
@@ -357,6 +406,11 @@ void MainWindow::tabHasChanged()
 
     Editor *e = currentEditor();
     emit tabChanged(e!=NULL);
+
+    // the profile is stored per sketch
+    profileBox->setEnabled(e != NULL);
+    if (e != NULL)
+        profileBox->setCurrentIndex(qMax(0, Toolkit::buildProfiles().indexOf(ideApp->settings()->buildProfile(e->fileName()))));
 }
 
 void MainWindow::contextualHelp()
@@ -466,6 +520,52 @@ void MainWindow::finishedBuilding()
     emit buildFinished(true);
 }
 
+void MainWindow::addBuildDiagnostic(const Diagnostic &diagnostic)
+{
+    // the editor may have been closed since the build started
+    if (buildEditor)
+        buildEditor->addDiagnostic(diagnostic);
+}
+
+void MainWindow::logBuildPhase(const QString &phase, qint64 msecs)
+{
+    if (ideApp->settings()->buildTiming())
+        ui.outputView->logPhase(phase, msecs);
+}
+
+void MainWindow::scheduleSyntaxCheck()
+{
+    if (! ideApp->settings()->syntaxCheck())
+        return;
+
+    // the running check is about an older text
+    syntaxChecker->cancel();
+    syntaxCheckTimer->start();
+}
+
+void MainWindow::checkSyntax()
+{
+    Editor *editor = currentEditor();
+    if (editor)
+    {
+        checkEditor = editor;
+        syntaxChecker->backgroundCheck(editor->text(), editor->fileName());
+    }
+}
+
+void MainWindow::syntaxChecked(bool ok, const QList<Diagnostic> &diagnostics)
+{
+    Q_UNUSED(ok);
+
+    // ignore the results of a text modified since
+    if (! checkEditor || syntaxCheckTimer->isActive())
+        return;
+
+    checkEditor->clearDiagnostics();
+    foreach (const Diagnostic &diagnostic, diagnostics)
+        checkEditor->addDiagnostic(diagnostic);
+}
+
 void MainWindow::showFindBox(bool show)
 {
      ui.dockFindReplace->setVisible(show);
@@ -622,7 +722,11 @@ void MainWindow::save_generic(bool saveas)
     Editor *e = currentEditor();
     if (e)
     {
+        // the sketch keeps its profile under its new name
+        QString profile = ideApp->settings()->buildProfile(e->fileName());
         e->save(saveas);
+        if (saveas)
+            ideApp->settings()->setBuildProfile(e->fileName(), profile);
 
         // the file name changed, update the tab text
         int index = ui.tabWidget->currentIndex();
@@ -741,20 +845,16 @@ void MainWindow::build()
     {
         ui.dockWidget->show();
         ui.outputView->clear();
+        editor->clearDiagnostics();
 
         if (editor->isModified())
         {
             save();
         }
-        BackgroundBuilder *builder = new BackgroundBuilder(ui.outputView);
-        builder->setRelatedActions(buildActions);
-        connect(builder, SIGNAL(buildFinished(bool)), builder, SLOT(deleteLater()));
-        connect(builder, SIGNAL(buildFinished(bool)), this, SIGNAL(buildFinished(bool)));
-        connect(builder, SIGNAL(log(QString)), ui.outputView, SLOT(log(QString)));
-        connect(builder, SIGNAL(logError(QString)), ui.outputView, SLOT(logError(QString)));
-        connect(builder, SIGNAL(logImportant(QString)), ui.outputView, SLOT(logImportant(QString)));
-        connect(builder, SIGNAL(logCommand(QStringList)), ui.outputView, SLOT(logCommand(QStringList)));
-        builder->backgroundBuild(editor->text());
+        syntaxCheckTimer->stop();
+        syntaxChecker->cancel();
+        buildEditor = editor;
+        backgroundBuilder->backgroundBuild(editor->text(), false, editor->fileName());
     }
 }
 
@@ -763,25 +863,18 @@ void MainWindow::upload()
     Editor *editor = currentEditor();
     if (editor)
     {
-        buildActions->setEnabled(false);
-
-        QString device = ideApp->settings()->devicePort();
         ui.dockWidget->show();
         ui.outputView->clear();
+        editor->clearDiagnostics();
 
         if (editor->isModified())
         {
             save();
         }
-        BackgroundBuilder *builder = new BackgroundBuilder(ui.outputView);
-        builder->setRelatedActions(buildActions);
-        connect(builder, SIGNAL(buildFinished(bool)), builder, SLOT(deleteLater()));
-        connect(builder, SIGNAL(buildFinished(bool)), this, SIGNAL(uploadFinished(bool)));
-        connect(builder, SIGNAL(log(QString)), ui.outputView, SLOT(log(QString)));
-        connect(builder, SIGNAL(logError(QString)), ui.outputView, SLOT(logError(QString)));
-        connect(builder, SIGNAL(logImportant(QString)), ui.outputView, SLOT(logImportant(QString)));
-        connect(builder, SIGNAL(logCommand(QStringList)), ui.outputView, SLOT(logCommand(QStringList)));
-        builder->backgroundBuild(editor->text(), true);
+        syntaxCheckTimer->stop();
+        syntaxChecker->cancel();
+        buildEditor = editor;
+        backgroundBuilder->backgroundBuild(editor->text(), true, editor->fileName());
     }
 }
 
@@ -35,8 +35,10 @@ This program is free software; you can redistribute it and/or modify
 #include <QComboBox>
 #include <QToolButton>
 #include <QNetworkAccessManager>
+#include <QPointer>
 
 #include "IDEGlobal.h"
+#include "env/Diagnostic.h"
 
 class QUrl;
 class Browser;
@@ -46,6 +48,8 @@ class QCloseEvent;
 class DeviceChooser;
 class BoardChooser;
 class ConfigDialog;
+class BackgroundBuilder;
+class QTimer;
 
 class QNetworkReply;
 
@@ -94,12 +98,18 @@ public slots:
     bool docHelpRequested(QString);
     void refreshLibrariesMenu();
     void refreshTitle();
+    void scheduleSyntaxCheck();
 
 private slots:
     void openCommunityArduinoCC();
     void openCommunityArduinoForums();
     void pastebinUploadDone(QNetworkReply* reply);
     void finishedBuilding();
+    void addBuildDiagnostic(const Diagnostic &diagnostic);
+    void logBuildPhase(const QString &phase, qint64 msecs);
+    void setBuildProfile(int index);
+    void checkSyntax();
+    void syntaxChecked(bool ok, const QList<Diagnostic> &diagnostics);
     void showFindBox(bool show);
     void save_generic(bool saveas);
     bool find();
@@ -113,6 +123,7 @@ private:
     void createBrowserAndTabs();
     void createDeviceChooser();
     void createBoardChooser();
+    void createProfileChooser();
 
     QStringList names;
     QString createUniqueName(const QString &name);
@@ -122,9 +133,17 @@ private:
     DeviceChooser *deviceChooser;
     QAction *boardAction;
     BoardChooser *boardChooser;
+    QComboBox *profileBox;
 
     QActionGroup *buildActions;
 
+    BackgroundBuilder *backgroundBuilder;
+    QPointer<Editor> buildEditor;
+
+    BackgroundBuilder *syntaxChecker;
+    QTimer *syntaxCheckTimer;
+    QPointer<Editor> checkEditor;
+
     ConfigDialog *configDialog;
 
     QList<Editor *> editors();
@@ -70,6 +70,15 @@ void OutputView::logCommand(const QString &command)
     log(format.arg(command));
 }
 
+void OutputView::logPhase(const QString &phase, qint64 msecs)
+{
+    static const QString format = tr("%0: %1 ms");
+    QColor oldColor = textColor();
+    setTextColor(Qt::gray);
+    log(format.arg(phase).arg(msecs));
+    setTextColor(oldColor);
+}
+
 void OutputView::logCommand(const QStringList &command)
 {
     setTextColor(Qt::gray);
@@ -47,6 +47,7 @@ public slots:
     void logError(const QString &text);
     void logCommand(const QString &command);
     void logCommand(const QStringList &command);
+    void logPhase(const QString &phase, qint64 msecs);
 };
 
 #endif // OUTPUTVIEW_H
@@ -27,10 +27,18 @@
  */
 
 #include "IDEApplication.h"
+#include "env/CommandLine.h"
+#include "env/StubToolchain.h"
 
 int main(int argc, char** argv)
 {
+    // the benchmarks start the executable as a fake compiler
+    if (StubToolchain::isInvoked(argv[0]))
+        return StubToolchain::run(argc, argv);
+
     IDEApplication *app = new IDEApplication(argc, argv);
+    if (! app->gui())
+        return CommandLine().exec(app->arguments());
     return app->exec();
 }
 
@@ -49,6 +57,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     freopen_s(&stream, "CONOUT$", "wb", stdout);
     freopen_s(&stream, "CONOUT$", "wb", stderr);
     std::ios::sync_with_stdio();
+#else
+    // command line builds print to the console they were started from
+    if (CommandLine::isRequested(__argc, __argv) && AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        FILE *stream;
+        freopen_s(&stream, "CONOUT$", "wb", stdout);
+        freopen_s(&stream, "CONOUT$", "wb", stderr);
+    }
 #endif
 
     int ec = main(__argc, __argv);
@@ -46,8 +46,14 @@ bool SerialPlugin::setup(IDEApplication *app)
     connect(widget, SIGNAL(readRequested()), this, SLOT(read()));
     connect(widget, SIGNAL(writeRequested(const QByteArray &)), this, SLOT(write(const QByteArray &)));
     connect(widget, SIGNAL(readModeChangeRequested(bool)), this, SLOT(changeReadMode(bool)));
+    connect(widget, SIGNAL(recordModeChangeRequested(bool)), this, SLOT(changeRecordMode(bool)));
+    connect(widget, SIGNAL(captureOpenRequested(const QString &)), this, SLOT(openCapture(const QString &)));
     connect(this, SIGNAL(currentStateChanged(bool)), widget, SLOT(serialOpenEvent(bool)));
 
+    connect(widget, SIGNAL(scrollbackSizeChanged(int)), this, SLOT(saveScrollbackSize(int)));
+    widget->setScrollbackSize(app->settings()->serialScrollback());
+    widget->setRecorder(&mRecorder);
+
     return true;
 }
 
@@ -132,14 +138,81 @@ void SerialPlugin::changeReadMode(bool mode)
         connect(mSerial.data(), SIGNAL(dataArrived(QByteArray)), this, SLOT(continuousRead(QByteArray)));
     else
         disconnect(mSerial.data(), SIGNAL(dataArrived(QByteArray)), this, SLOT(continuousRead(QByteArray)));
+
+    // the data is always shown, and also recorded if requested
+    if (mode && widget->isRecordRequested())
+        startRecording();
+    else if (! mode)
+        stopRecording();
+}
+
+void SerialPlugin::changeRecordMode(bool record)
+{
+    if (mSerial.data() == NULL || ! mSerial->isInReadEventMode())
+        return;
+
+    if (record)
+        startRecording();
+    else
+        stopRecording();
+}
+
+void SerialPlugin::startRecording()
+{
+    if (! mRecorder.create(SerialRecorder::newFileName()))
+    {
+        widget->setStatus(tr("Unable to record, the data is only shown: %0").arg(mRecorder.errorString()));
+        widget->setRecordRequested(false);
+    }
+    else
+        widget->setStatus(tr("Recording to %0.").arg(mRecorder.fileName()));
+    widget->updateCapture();
+}
+
+void SerialPlugin::stopRecording()
+{
+    if (! mRecorder.isRecording())
+        return;
+
+    mRecorder.stop();
+    widget->setStatus(tr("Recorded %0 bytes to %1.").arg(mRecorder.size()).arg(mRecorder.fileName()));
+    widget->updateCapture();
 }
 
 void SerialPlugin::continuousRead(const QByteArray &data)
 {
-    QSharedPointer<QByteArray> currentData = widget->data();
-    currentData->append(data);
+    if (mRecorder.isRecording())
+    {
+        if (! mRecorder.append(data))
+        {
+            QString error = mRecorder.errorString();
+            stopRecording();
+            widget->setRecordRequested(false);
+            widget->setStatus(tr("Capture error, the data is only shown: %0").arg(error));
+        }
+        // a full capture goes on in a new file
+        else if (mRecorder.isFull())
+            startRecording();
+    }
+
+    widget->appendData(data);
+}
+
+void SerialPlugin::openCapture(const QString &fileName)
+{
+    if (mRecorder.isRecording())
+        return;
 
-    widget->setData(currentData);
+    if (! mRecorder.open(fileName))
+        widget->setStatus(tr("Unable to open the capture: %0").arg(mRecorder.errorString()));
+    else
+        widget->setStatus(tr("Opened %0.").arg(fileName));
+    widget->updateCapture();
+}
+
+void SerialPlugin::saveScrollbackSize(int size)
+{
+    mApp->settings()->setSerialScrollback(size);
 }
 
 Q_EXPORT_PLUGIN2(serial, SerialPlugin)
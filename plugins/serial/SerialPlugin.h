@@ -34,6 +34,7 @@ This program is free software; you can redistribute it and/or modify
 #include <QScopedPointer>
 
 #include "utils/Serial.h"
+#include "SerialRecorder.h"
 
 class SerialWidget;
 
@@ -55,15 +56,22 @@ private slots:
     void read();
     void write(const QByteArray &data);
     void changeReadMode(bool mode);
+    void changeRecordMode(bool record);
     void continuousRead(const QByteArray &data);
+    void openCapture(const QString &fileName);
+    void saveScrollbackSize(int size);
 
 private:
+    void startRecording();
+    void stopRecording();
+
     IDEApplication *mApp;
 
     QString mName;
     SerialWidget *widget;
 
     QScopedPointer<Serial> mSerial;
+    SerialRecorder mRecorder;
 };
 
 #endif // SERIALPLUGIN_H
@@ -0,0 +1,350 @@
+/*
+  SerialRecorder.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file SerialRecorder.cpp
+ * \author Denis Martinez
+ */
+
+#include "SerialRecorder.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QDesktopServices>
+#include <QtEndian>
+
+// identifies an index file, written before the entries
+static const char indexMagic[] = "ARDUIDX1";
+static const int indexHeaderSize = sizeof(indexMagic) - 1;
+
+// an index entry is a time in ms since the epoch followed by an offset
+static const int indexEntrySize = 2 * sizeof(qint64);
+
+// minimum time between two index entries, in ms
+static const qint64 indexInterval = 100;
+
+// size past which a capture is full
+static const qint64 maxCaptureSize = Q_INT64_C(256) * 1024 * 1024;
+
+// total size of the captures kept in the default directory
+static const qint64 maxDirectorySize = Q_INT64_C(1024) * 1024 * 1024;
+
+SerialRecorder::SerialRecorder()
+    : mIndexMap(NULL),
+      mIndexMapCount(0),
+      mIndexCount(0),
+      mSize(0),
+      mLastIndexTime(0)
+{
+}
+
+SerialRecorder::~SerialRecorder()
+{
+    close();
+}
+
+QString SerialRecorder::defaultDirectory()
+{
+    return QDir(QDesktopServices::storageLocation(QDesktopServices::DataLocation)).filePath("captures");
+}
+
+QString SerialRecorder::newFileName()
+{
+    QString name = QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".cap";
+    return QDir(defaultDirectory()).filePath(name);
+}
+
+QString SerialRecorder::indexFileName(const QString &fileName)
+{
+    return fileName + ".idx";
+}
+
+bool SerialRecorder::create(const QString &fileName)
+{
+    close();
+
+    if (! QDir().mkpath(QFileInfo(fileName).path()))
+    {
+        mError = QObject::tr("Can't create the directory of %0.").arg(fileName);
+        return false;
+    }
+
+    // the captures saved elsewhere are left alone
+    if (QFileInfo(fileName).absolutePath() == QDir(defaultDirectory()).absolutePath())
+        removeOldCaptures();
+
+    mWriter.setFileName(fileName);
+    mIndexWriter.setFileName(indexFileName(fileName));
+    if (! mWriter.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        mError = mWriter.errorString();
+        close();
+        return false;
+    }
+    if (! mIndexWriter.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || mIndexWriter.write(indexMagic, indexHeaderSize) != indexHeaderSize
+        || ! mIndexWriter.flush())
+    {
+        mError = mIndexWriter.errorString();
+        close();
+        return false;
+    }
+
+    return openReaders(fileName);
+}
+
+void SerialRecorder::removeOldCaptures()
+{
+    QDir dir(defaultDirectory());
+    QFileInfoList captures = dir.entryInfoList(QStringList() << "*.cap", QDir::Files, QDir::Time | QDir::Reversed);
+
+    QList<qint64> sizes;
+    qint64 total = 0;
+    foreach (const QFileInfo &capture, captures)
+    {
+        qint64 size = capture.size() + QFileInfo(indexFileName(capture.filePath())).size();
+        sizes << size;
+        total += size;
+    }
+
+    // oldest first
+    for (int i = 0; i < captures.size() && total > maxDirectorySize - maxCaptureSize; i++)
+    {
+        QString fileName = captures.at(i).filePath();
+        if (QFile::remove(fileName))
+        {
+            QFile::remove(indexFileName(fileName));
+            total -= sizes.at(i);
+        }
+    }
+}
+
+bool SerialRecorder::open(const QString &fileName)
+{
+    close();
+    return openReaders(fileName);
+}
+
+bool SerialRecorder::isFull() const
+{
+    return mSize >= maxCaptureSize;
+}
+
+void SerialRecorder::stop()
+{
+    flush();
+    mWriter.close();
+    mIndexWriter.close();
+}
+
+bool SerialRecorder::openReaders(const QString &fileName)
+{
+    mReader.setFileName(fileName);
+    if (! mReader.open(QIODevice::ReadOnly))
+    {
+        mError = mReader.errorString();
+        close();
+        return false;
+    }
+    mSize = mReader.size();
+
+    mIndexReader.setFileName(indexFileName(fileName));
+    if (mIndexReader.open(QIODevice::ReadOnly))
+    {
+        if (mIndexReader.read(indexHeaderSize) == QByteArray(indexMagic, indexHeaderSize))
+            mIndexCount = (mIndexReader.size() - indexHeaderSize) / indexEntrySize;
+        else
+            mIndexReader.close();
+    }
+
+    return true;
+}
+
+void SerialRecorder::close()
+{
+    if (mIndexMap != NULL)
+        mIndexReader.unmap(mIndexMap);
+    mIndexMap = NULL;
+    mIndexMapCount = 0;
+
+    mWriter.close();
+    mIndexWriter.close();
+    mReader.close();
+    mIndexReader.close();
+    mIndexCount = 0;
+    mSize = 0;
+    mLastIndexTime = 0;
+}
+
+bool SerialRecorder::append(const QByteArray &data, const QDateTime &time)
+{
+    if (! isRecording())
+    {
+        mError = QObject::tr("The capture is not being recorded.");
+        return false;
+    }
+    if (data.isEmpty())
+        return true;
+
+    qint64 offset = mSize;
+    if (mWriter.write(data) != data.size())
+    {
+        mError = mWriter.errorString();
+        return false;
+    }
+    mSize += data.size();
+
+    qint64 msecs = time.toMSecsSinceEpoch();
+    if (mIndexCount == 0 || msecs - mLastIndexTime >= indexInterval)
+    {
+        // the data must reach the disk before an entry points to it
+        if (! mWriter.flush())
+        {
+            mError = mWriter.errorString();
+            return false;
+        }
+
+        uchar entry[indexEntrySize];
+        qToLittleEndian<qint64>(msecs, entry);
+        qToLittleEndian<qint64>(offset, entry + sizeof(qint64));
+        if (mIndexWriter.write(reinterpret_cast<const char *>(entry), indexEntrySize) != indexEntrySize
+            || ! mIndexWriter.flush())
+        {
+            mError = mIndexWriter.errorString();
+            return false;
+        }
+
+        mIndexCount++;
+        mLastIndexTime = msecs;
+
+        // the index is opened once it has its header
+        if (! mIndexReader.isOpen())
+            mIndexReader.open(QIODevice::ReadOnly);
+    }
+
+    return true;
+}
+
+QByteArray SerialRecorder::read(qint64 offset, int maxSize)
+{
+    if (! isOpen() || offset < 0 || offset >= mSize || maxSize <= 0 || ! flush())
+        return QByteArray();
+
+    qint64 size = qMin(qint64(maxSize), mSize - offset);
+    uchar *map = mReader.map(offset, size);
+    if (map != NULL)
+    {
+        QByteArray data(reinterpret_cast<const char *>(map), size);
+        mReader.unmap(map);
+        return data;
+    }
+
+    // some file systems can't be mapped
+    if (! mReader.seek(offset))
+    {
+        mError = mReader.errorString();
+        return QByteArray();
+    }
+    return mReader.read(size);
+}
+
+qint64 SerialRecorder::offsetAt(const QDateTime &time)
+{
+    qint64 i = findEntry(time.toMSecsSinceEpoch(), true);
+    if (i < 0)
+        return 0;
+
+    qint64 msecs, offset;
+    indexEntry(i, &msecs, &offset);
+    return offset;
+}
+
+QDateTime SerialRecorder::timeAt(qint64 offset)
+{
+    qint64 i = findEntry(offset, false);
+    if (i < 0)
+        return QDateTime();
+
+    qint64 msecs, entryOffset;
+    indexEntry(i, &msecs, &entryOffset);
+    return QDateTime::fromMSecsSinceEpoch(msecs);
+}
+
+qint64 SerialRecorder::indexCount() const
+{
+    return mIndexReader.isOpen() ? mIndexCount : 0;
+}
+
+bool SerialRecorder::mapIndex()
+{
+    qint64 count = indexCount();
+    if (count == 0)
+        return false;
+    if (mIndexMap != NULL && mIndexMapCount == count)
+        return true;
+
+    if (mIndexMap != NULL)
+        mIndexReader.unmap(mIndexMap);
+    mIndexMap = mIndexReader.map(0, indexHeaderSize + count * indexEntrySize);
+    mIndexMapCount = mIndexMap != NULL ? count : 0;
+    if (mIndexMap == NULL)
+        mError = mIndexReader.errorString();
+    return mIndexMap != NULL;
+}
+
+void SerialRecorder::indexEntry(qint64 i, qint64 *time, qint64 *offset) const
+{
+    const uchar *entry = mIndexMap + indexHeaderSize + i * indexEntrySize;
+    *time = qFromLittleEndian<qint64>(entry);
+    *offset = qFromLittleEndian<qint64>(entry + sizeof(qint64));
+}
+
+qint64 SerialRecorder::findEntry(qint64 value, bool byTime)
+{
+    if (! mapIndex())
+        return -1;
+
+    // the entries are sorted by offset, and by time unless the clock went back
+    qint64 first = 0, last = mIndexMapCount;
+    while (first < last)
+    {
+        qint64 middle = first + (last - first) / 2;
+        qint64 time, offset;
+        indexEntry(middle, &time, &offset);
+        if ((byTime ? time : offset) <= value)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return first - 1;
+}
+
+bool SerialRecorder::flush()
+{
+    if (isRecording() && ! mWriter.flush())
+    {
+        mError = mWriter.errorString();
+        return false;
+    }
+    return true;
+}
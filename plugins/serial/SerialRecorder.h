@@ -0,0 +1,265 @@
+/*
+  SerialRecorder.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file SerialRecorder.h
+ * \author Denis Martinez
+ */
+
+#ifndef SERIALRECORDER_H
+#define SERIALRECORDER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+
+/**
+ * @brief Capture file of the data read from a serial port
+ *
+ * The data is appended as is to a capture file, so that the file can be
+ * inspected by any other tool. A separate index file records when the data
+ * arrived: each entry pairs a time with the offset of the chunk received at
+ * that time, at most one entry every few milliseconds.
+ *
+ * Both files are only appended to, and read back by mapping them in memory
+ * page by page, so that captures much larger than the memory can be kept and
+ * browsed.
+ *
+ * The default directory is bounded: creating a capture there first removes
+ * the oldest captures, and a capture is full past a maximum size, after which
+ * a new one should be started.
+ */
+class SerialRecorder
+{
+public:
+    SerialRecorder();
+    ~SerialRecorder();
+
+    /**
+     * @brief Return the directory new captures are stored in
+     *
+     * @return QString
+     */
+    static QString defaultDirectory();
+
+    /**
+     * @brief Return the name of a new capture file, based on the current time
+     *
+     * @return QString
+     */
+    static QString newFileName();
+
+    /**
+     * @brief Start recording to a new capture file
+     *
+     * An existing capture is overwritten. In the default directory, the oldest
+     * captures are removed to leave room for the new one.
+     *
+     * @param fileName Capture file, the index is stored next to it
+     * @return bool, True on success or False on error
+     */
+    bool create(const QString &fileName);
+
+    /**
+     * @brief Open an existing capture file for reading
+     *
+     * A capture without an index can still be read, but not searched by time.
+     *
+     * @param fileName Capture file
+     * @return bool, True on success or False on error
+     */
+    bool open(const QString &fileName);
+
+    /**
+     * @brief Stop recording, the capture stays opened for reading
+     *
+     * @return void
+     */
+    void stop();
+
+    /**
+     * @brief Close the capture
+     *
+     * @return void
+     */
+    void close();
+
+    /**
+     * @brief Return True if a capture is opened
+     *
+     * @return bool
+     */
+    bool isOpen() const { return mReader.isOpen(); }
+
+    /**
+     * @brief Return True if the capture is being recorded
+     *
+     * @return bool
+     */
+    bool isRecording() const { return mWriter.isOpen(); }
+
+    /**
+     * @brief Return the name of the capture file
+     *
+     * @return QString
+     */
+    QString fileName() const { return mReader.fileName(); }
+
+    /**
+     * @brief Return the last error
+     *
+     * @return QString
+     */
+    const QString &errorString() const { return mError; }
+
+    /**
+     * @brief Return the size of the data captured
+     *
+     * @return qint64
+     */
+    qint64 size() const { return mSize; }
+
+    /**
+     * @brief Return True if the capture reached its maximum size
+     *
+     * @return bool
+     */
+    bool isFull() const;
+
+    /**
+     * @brief Append some data to the capture
+     *
+     * @param data Data read from the port
+     * @param time Time at which the data was read
+     * @return bool, True on success or False on error
+     */
+    bool append(const QByteArray &data, const QDateTime &time = QDateTime::currentDateTime());
+
+    /**
+     * @brief Read some data from the capture
+     *
+     * @param offset Offset of the data
+     * @param maxSize Maximum number of bytes
+     * @return QByteArray, empty on error
+     */
+    QByteArray read(qint64 offset, int maxSize);
+
+    /**
+     * @brief Return the offset of the first data received at a given time
+     *
+     * @param time Time
+     * @return qint64, 0 if the time is before the capture or not indexed
+     */
+    qint64 offsetAt(const QDateTime &time);
+
+    /**
+     * @brief Return the time at which some data was received
+     *
+     * The time is precise to the indexing interval.
+     *
+     * @param offset Offset of the data
+     * @return QDateTime, invalid if the capture is not indexed
+     */
+    QDateTime timeAt(qint64 offset);
+
+    /**
+     * @brief Return the name of the index of a capture file
+     *
+     * @param fileName Capture file
+     * @return QString
+     */
+    static QString indexFileName(const QString &fileName);
+
+private:
+    /**
+     * @brief Remove the oldest captures of the default directory
+     *
+     * The captures left, with their index, take at most the size of the
+     * directory minus the size of a full capture.
+     *
+     * @return void
+     */
+    static void removeOldCaptures();
+
+    /**
+     * @brief Open the capture and its index for reading
+     *
+     * @param fileName Capture file
+     * @return bool, True on success or False on error
+     */
+    bool openReaders(const QString &fileName);
+
+    /**
+     * @brief Return the number of entries in the index
+     *
+     * @return qint64
+     */
+    qint64 indexCount() const;
+
+    /**
+     * @brief Map the index in memory, including the entries added since the last call
+     *
+     * @return bool, True on success or False on error
+     */
+    bool mapIndex();
+
+    /**
+     * @brief Read an entry of the mapped index
+     *
+     * @param i Entry number
+     * @param time Filled with the time of the entry, in ms since the epoch
+     * @param offset Filled with the offset of the entry
+     * @return void
+     */
+    void indexEntry(qint64 i, qint64 *time, qint64 *offset) const;
+
+    /**
+     * @brief Find the last entry of the index matching a condition
+     *
+     * @param value Time or offset searched
+     * @param byTime True to search by time, False to search by offset
+     * @return qint64, -1 if every entry is after the value
+     */
+    qint64 findEntry(qint64 value, bool byTime);
+
+    /**
+     * @brief Write the buffered data to the disk
+     *
+     * @return bool, True on success or False on error
+     */
+    bool flush();
+
+    QFile mWriter;
+    QFile mIndexWriter;
+    QFile mReader;
+    QFile mIndexReader;
+    uchar *mIndexMap;
+    qint64 mIndexMapCount;
+    qint64 mIndexCount;
+    qint64 mSize;
+    qint64 mLastIndexTime;
+    QString mError;
+};
+
+#endif // SERIALRECORDER_H
@@ -29,14 +29,33 @@ This program is free software; you can redistribute it and/or modify
 #include "SerialWidget.h"
 
 #include <QDebug>
+#include <QIntValidator>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QTimer>
+#include <climits>
 
 #include "utils/Serial.h"
+#include "SerialRecorder.h"
+
+// number of bytes of a capture shown at once
+static const int pageSize = 64 * 1024;
+
+// minimum time between two updates of the view, in ms
+static const int refreshInterval = 1000 / 60;
 
 SerialWidget::SerialWidget(QWidget *parent)
-    : QWidget(parent)
+    : QWidget(parent),
+      mRecorder(NULL),
+      mScrollbackSize(0)
 {
     setupUi(this);
 
+    mRefreshTimer = new QTimer(this);
+    mRefreshTimer->setSingleShot(true);
+    mRefreshTimer->setInterval(refreshInterval);
+    connect(mRefreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+
     mDialog = new SerialWriteDialog(this);
     mDialog->installEventFilter(this);
 
@@ -48,6 +67,10 @@ SerialWidget::SerialWidget(QWidget *parent)
             baudRateBox->setCurrentIndex(index);
         index++;
     }
+    // any other rate can be typed in
+    baudRateBox->setEditable(true);
+    baudRateBox->setInsertPolicy(QComboBox::NoInsert);
+    baudRateBox->setValidator(new QIntValidator(1, INT_MAX, baudRateBox));
 
     QSharedPointer<QByteArray> sp(new QByteArray("No data."));
     setData(sp);
@@ -60,6 +83,12 @@ SerialWidget::SerialWidget(QWidget *parent)
     connect(writeButton, SIGNAL(clicked(bool)), this, SLOT(setWriteDialogVisible(bool)));
     connect(mDialog, SIGNAL(writeRequested(const QByteArray &)), this, SIGNAL(writeRequested(const QByteArray &)));
     connect(checkContinuousRead, SIGNAL(toggled(bool)), this, SLOT(checkReadMode_clicked(bool)));
+    connect(pageBox, SIGNAL(valueChanged(int)), this, SLOT(pageBox_valueChanged(int)));
+    connect(followBox, SIGNAL(toggled(bool)), this, SLOT(followBox_toggled(bool)));
+    connect(recordBox, SIGNAL(toggled(bool)), this, SIGNAL(recordModeChangeRequested(bool)));
+    connect(goButton, SIGNAL(clicked()), this, SLOT(goButton_clicked()));
+    connect(openCaptureButton, SIGNAL(clicked()), this, SLOT(openCaptureButton_clicked()));
+    connect(scrollbackBox, SIGNAL(valueChanged(int)), this, SLOT(scrollbackBox_valueChanged(int)));
 }
 
 void SerialWidget::setStatus(const QString &text)
@@ -69,7 +98,7 @@ void SerialWidget::setStatus(const QString &text)
 
 int SerialWidget::baudRate()
 {
-    return baudRateBox->itemData(baudRateBox->currentIndex()).toInt();
+    return baudRateBox->currentText().toInt();
 }
 
 int SerialWidget::readCount()
@@ -84,10 +113,193 @@ const QSharedPointer<QByteArray> SerialWidget::data() const
 
 void SerialWidget::setData(const QSharedPointer<QByteArray> &data)
 {
+    hexView->setAddressOffset(0);
+    hexView->setData(data);
+    hexView->scrollToBottom();
+}
+
+void SerialWidget::setRecorder(SerialRecorder *recorder)
+{
+    mRecorder = recorder;
+    updateCapture();
+}
+
+void SerialWidget::setScrollbackSize(int size)
+{
+    scrollbackBox->blockSignals(true);
+    scrollbackBox->setValue(size);
+    scrollbackBox->blockSignals(false);
+    mScrollbackSize = scrollbackBox->value() * 1024;
+    trimScrollback();
+}
+
+bool SerialWidget::isRecordRequested() const
+{
+    return recordBox->isChecked();
+}
+
+void SerialWidget::setRecordRequested(bool record)
+{
+    recordBox->blockSignals(true);
+    recordBox->setChecked(record);
+    recordBox->blockSignals(false);
+}
+
+bool SerialWidget::isLive() const
+{
+    return followBox->isChecked() || mRecorder == NULL || ! mRecorder->isOpen();
+}
+
+void SerialWidget::trimScrollback()
+{
+    // a page of a capture is not trimmed
+    int excess = hexView->dataSize() - mScrollbackSize;
+    if (isLive() && excess > 0)
+        hexView->removeData(excess);
+}
+
+void SerialWidget::updateCapture()
+{
+    mPending.clear();
+
+    bool opened = mRecorder != NULL && mRecorder->isOpen();
+    pageBox->setEnabled(opened);
+    timeEdit->setEnabled(opened);
+    goButton->setEnabled(opened);
+    if (! opened)
+    {
+        captureLabel->setText(tr("No capture."));
+        return;
+    }
+
+    updatePages();
+    if (followBox->isChecked())
+        showTail();
+    else
+        showPage(pageBox->value());
+}
+
+void SerialWidget::appendData(const QByteArray &data)
+{
+    // the view is updated at most once per refresh interval
+    if (isLive())
+        mPending << data;
+    if (! mRefreshTimer->isActive())
+        mRefreshTimer->start();
+}
+
+void SerialWidget::refresh()
+{
+    if (mRecorder != NULL && mRecorder->isOpen())
+        updatePages();
+    if (mPending.isEmpty())
+        return;
+
+    bool atBottom = hexView->isAtBottom();
+    foreach (const QByteArray &data, mPending)
+        hexView->appendData(data);
+    mPending.clear();
+
+    // the view drops whole chunks, so the rows don't move at every refresh
+    trimScrollback();
+
+    if (atBottom)
+        hexView->scrollToBottom();
+}
+
+void SerialWidget::updatePages()
+{
+    captureLabel->setText(tr("%0, %1 bytes.")
+                          .arg(QFileInfo(mRecorder->fileName()).fileName())
+                          .arg(mRecorder->size()));
+
+    pageBox->blockSignals(true);
+    pageBox->setMaximum(pageCount());
+    if (followBox->isChecked())
+        pageBox->setValue(pageBox->maximum());
+    pageBox->blockSignals(false);
+}
+
+void SerialWidget::showTail()
+{
+    qint64 offset = qMax(qint64(0), mRecorder->size() - mScrollbackSize);
+    offset -= offset % (hexView->rowWidth() * hexView->wordWidth());
+    QSharedPointer<QByteArray> data(new QByteArray(mRecorder->read(offset, mRecorder->size() - offset)));
+    hexView->setAddressOffset(QHexView::address_t(offset));
     hexView->setData(data);
     hexView->scrollToBottom();
 }
 
+void SerialWidget::showPage(int page, int position)
+{
+    if (mRecorder == NULL || ! mRecorder->isOpen())
+        return;
+
+    qint64 offset = qint64(page - 1) * pageSize;
+    QSharedPointer<QByteArray> data(new QByteArray(mRecorder->read(offset, pageSize)));
+    hexView->setAddressOffset(QHexView::address_t(offset));
+    hexView->setData(data);
+    hexView->scrollTo(position);
+
+    QDateTime time = mRecorder->timeAt(offset + position);
+    if (time.isValid())
+        timeEdit->setDateTime(time);
+}
+
+int SerialWidget::pageCount() const
+{
+    if (mRecorder == NULL || mRecorder->size() == 0)
+        return 1;
+    return int((mRecorder->size() - 1) / pageSize) + 1;
+}
+
+void SerialWidget::stopFollowing()
+{
+    followBox->blockSignals(true);
+    followBox->setChecked(false);
+    followBox->blockSignals(false);
+    mPending.clear();
+}
+
+void SerialWidget::pageBox_valueChanged(int page)
+{
+    stopFollowing();
+    showPage(page);
+}
+
+void SerialWidget::followBox_toggled(bool)
+{
+    updateCapture();
+}
+
+void SerialWidget::goButton_clicked()
+{
+    if (mRecorder == NULL || ! mRecorder->isOpen())
+        return;
+
+    stopFollowing();
+    qint64 offset = mRecorder->offsetAt(timeEdit->dateTime());
+    int page = int(offset / pageSize) + 1;
+    pageBox->blockSignals(true);
+    pageBox->setValue(page);
+    pageBox->blockSignals(false);
+    showPage(page, int(offset % pageSize));
+}
+
+void SerialWidget::scrollbackBox_valueChanged(int size)
+{
+    mScrollbackSize = size * 1024;
+    trimScrollback();
+    emit scrollbackSizeChanged(size);
+}
+
+void SerialWidget::openCaptureButton_clicked()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open capture"), SerialRecorder::defaultDirectory(), tr("Captures (*.cap)"));
+    if (! fileName.isEmpty())
+        emit captureOpenRequested(fileName);
+}
+
 void SerialWidget::setWriteDialogVisible(bool visible)
 {
     mDialog->setVisible(visible);
@@ -123,6 +335,7 @@ void SerialWidget::serialOpenEvent(bool opened)
     checkContinuousRead->setEnabled(opened);
     readButton->setEnabled(open_and_not_continuous);
     readCountBox->setEnabled(open_and_not_continuous);
+    openCaptureButton->setEnabled(!opened || open_and_not_continuous);
 }
 
 bool SerialWidget::eventFilter(QObject *obj, QEvent *event)
@@ -32,11 +32,15 @@ This program is free software; you can redistribute it and/or modify
 #include "plugins/ui_SerialWidget.h"
 
 #include <QSharedPointer>
+#include <QList>
 
 #include "SerialWriteDialog.h"
 
 #include "SerialPlugin.h"
 
+class QTimer;
+class SerialRecorder;
+
 class SerialWidget : public QWidget, Ui::SerialWidget
 {
     Q_OBJECT
@@ -49,6 +53,12 @@ public:
     const QSharedPointer<QByteArray> data() const;
     void setData(const QSharedPointer<QByteArray> &data);
     SerialWriteDialog *writeDialog() { return mDialog; }
+    void setRecorder(SerialRecorder *recorder);
+    void setScrollbackSize(int size);
+    void updateCapture();
+    void appendData(const QByteArray &data);
+    bool isRecordRequested() const;
+    void setRecordRequested(bool record);
 
 public slots:
     void setWriteDialogVisible(bool visible);
@@ -60,13 +70,33 @@ signals:
     void readRequested();
     void writeRequested(const QByteArray &data);
     void readModeChangeRequested(bool);
+    void recordModeChangeRequested(bool);
+    void captureOpenRequested(const QString &fileName);
+    void scrollbackSizeChanged(int size);
 
 private slots:
     void checkReadMode_clicked(bool value);
+    void pageBox_valueChanged(int page);
+    void followBox_toggled(bool value);
+    void goButton_clicked();
+    void openCaptureButton_clicked();
+    void refresh();
+    void scrollbackBox_valueChanged(int size);
 
 private:
     bool eventFilter(QObject *obj, QEvent *event);
+    bool isLive() const;
+    void trimScrollback();
+    void updatePages();
+    void showTail();
+    void showPage(int page, int position = 0);
+    int pageCount() const;
+    void stopFollowing();
     SerialWriteDialog *mDialog;
+    SerialRecorder *mRecorder;
+    int mScrollbackSize;
+    QList<QByteArray> mPending;
+    QTimer *mRefreshTimer;
 };
 
 #endif // SERIALWIDGET_H
@@ -0,0 +1,210 @@
+/*
+  ElfFile.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file ElfFile.cpp
+ * \author Denis Martinez
+ */
+
+#include "ElfFile.h"
+
+#include <QtEndian>
+#include <QByteArray>
+#include <QObject>
+
+// layout of the ELF32 structures
+static const quint32 elfHeaderSize = 52;
+static const quint32 sectionHeaderSize = 40;
+static const quint32 programHeaderSize = 32;
+static const quint32 symbolSize = 16;
+
+static inline quint16 read16(const uchar *p)
+{
+    return qFromLittleEndian<quint16>(p);
+}
+
+static inline quint32 read32(const uchar *p)
+{
+    return qFromLittleEndian<quint32>(p);
+}
+
+ElfFile::ElfFile(const QString &fileName)
+    : mFile(fileName),
+      mData(NULL),
+      mSize(0)
+{
+}
+
+ElfFile::~ElfFile()
+{
+    close();
+}
+
+bool ElfFile::open()
+{
+    close();
+
+    if (! mFile.open(QIODevice::ReadOnly))
+        return fail(mFile.errorString());
+    mSize = mFile.size();
+    mData = mFile.map(0, mSize);
+    if (mData == NULL)
+        return fail(mFile.errorString());
+
+    if (mSize < elfHeaderSize || mData[0] != 0x7f || mData[1] != 'E' || mData[2] != 'L' || mData[3] != 'F')
+        return fail(QObject::tr("Not an ELF file."));
+    // 32 bits, little-endian
+    if (mData[4] != 1 || mData[5] != 1)
+        return fail(QObject::tr("Unsupported ELF class or byte order."));
+
+    quint32 phoff = read32(mData + 28);
+    quint32 shoff = read32(mData + 32);
+    quint16 phentsize = read16(mData + 42);
+    quint16 phnum = read16(mData + 44);
+    quint16 shentsize = read16(mData + 46);
+    quint16 shnum = read16(mData + 48);
+    quint16 shstrndx = read16(mData + 50);
+
+    if ((phnum > 0 && phentsize < programHeaderSize) || (shnum > 0 && shentsize < sectionHeaderSize))
+        return fail(QObject::tr("Corrupted ELF headers."));
+    if (data(phoff, quint32(phnum) * phentsize) == NULL || data(shoff, quint32(shnum) * shentsize) == NULL)
+        return fail(QObject::tr("Truncated ELF file."));
+
+    for (quint16 i = 0; i < phnum; i++)
+    {
+        const uchar *p = mData + phoff + i * phentsize;
+        Segment segment;
+        segment.type = read32(p);
+        segment.offset = read32(p + 4);
+        segment.virtualAddress = read32(p + 8);
+        segment.physicalAddress = read32(p + 12);
+        segment.fileSize = read32(p + 16);
+        segment.memorySize = read32(p + 20);
+        mSegments << segment;
+    }
+
+    QList<quint32> nameOffsets;
+    for (quint16 i = 0; i < shnum; i++)
+    {
+        const uchar *p = mData + shoff + i * shentsize;
+        Section section;
+        nameOffsets << read32(p);
+        section.type = read32(p + 4);
+        section.flags = read32(p + 8);
+        section.address = read32(p + 12);
+        section.offset = read32(p + 16);
+        section.size = read32(p + 20);
+        section.link = read32(p + 24);
+        mSections << section;
+    }
+
+    // the names are only known once the string table is read
+    if (shstrndx < mSections.size())
+    {
+        for (int i = 0; i < mSections.size(); i++)
+            mSections[i].name = string(mSections.at(shstrndx), nameOffsets.at(i));
+    }
+
+    return true;
+}
+
+void ElfFile::close()
+{
+    if (mData != NULL)
+        mFile.unmap(const_cast<uchar *>(mData));
+    mData = NULL;
+    mSize = 0;
+    mFile.close();
+    mSections.clear();
+    mSegments.clear();
+}
+
+int ElfFile::sectionIndex(const QString &name) const
+{
+    for (int i = 0; i < mSections.size(); i++)
+    {
+        if (mSections.at(i).name == name)
+            return i;
+    }
+    return -1;
+}
+
+const uchar *ElfFile::sectionData(const Section &section) const
+{
+    if (section.type == SectionNoBits)
+        return NULL;
+    return data(section.offset, section.size);
+}
+
+const uchar *ElfFile::data(quint32 offset, quint32 size) const
+{
+    if (mData == NULL || offset > mSize || size > mSize - offset)
+        return NULL;
+    return mData + offset;
+}
+
+QList<ElfFile::Symbol> ElfFile::symbols() const
+{
+    QList<Symbol> symbols;
+    foreach (const Section &section, mSections)
+    {
+        if (section.type != SectionSymbolTable || section.link >= quint32(mSections.size()))
+            continue;
+
+        const uchar *p = sectionData(section);
+        if (p == NULL)
+            continue;
+
+        const Section &names = mSections.at(section.link);
+        // the first entry is reserved
+        for (quint32 offset = symbolSize; offset + symbolSize <= section.size; offset += symbolSize)
+        {
+            Symbol symbol;
+            symbol.name = string(names, read32(p + offset));
+            symbol.value = read32(p + offset + 4);
+            symbol.size = read32(p + offset + 8);
+            symbol.type = p[offset + 12] & 0xf;
+            symbol.sectionIndex = read16(p + offset + 14);
+            symbols << symbol;
+        }
+    }
+    return symbols;
+}
+
+bool ElfFile::fail(const QString &error)
+{
+    mErrorString = error;
+    close();
+    return false;
+}
+
+QString ElfFile::string(const Section &table, quint32 index) const
+{
+    const uchar *p = sectionData(table);
+    if (p == NULL || index >= table.size)
+        return QString();
+
+    const char *start = reinterpret_cast<const char *>(p) + index;
+    int length = qstrnlen(start, table.size - index);
+    return QString::fromLatin1(start, length);
+}
@@ -0,0 +1,159 @@
+/*
+  ElfFile.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file ElfFile.h
+ * \author Denis Martinez
+ */
+
+#ifndef ELFFILE_H
+#define ELFFILE_H
+
+#include <QFile>
+#include <QString>
+#include <QList>
+
+/**
+ * @brief Read-only view of a 32 bits little-endian ELF file, such as the AVR executables
+ *
+ * The file is mapped in memory, the section contents are accessed in place.
+ */
+class ElfFile
+{
+public:
+    enum
+    {
+        SectionProgBits = 1,
+        SectionSymbolTable = 2,
+        SectionNoBits = 8,
+
+        SectionFlagAlloc = 0x2,
+
+        SegmentLoad = 1,
+
+        SymbolObject = 1,
+        SymbolFunction = 2
+    };
+
+    struct Section
+    {
+        QString name;
+        quint32 type;
+        quint32 flags;
+        quint32 address;
+        quint32 offset;
+        quint32 size;
+        quint32 link;
+    };
+
+    struct Segment
+    {
+        quint32 type;
+        quint32 offset;
+        quint32 virtualAddress;
+        quint32 physicalAddress;
+        quint32 fileSize;
+        quint32 memorySize;
+    };
+
+    struct Symbol
+    {
+        QString name;
+        quint32 value;
+        quint32 size;
+        quint8 type;
+        quint16 sectionIndex;
+    };
+
+    explicit ElfFile(const QString &fileName);
+    ~ElfFile();
+
+    /**
+     * @brief Map the file and read its headers
+     *
+     * @return bool, True if success or False if not
+     */
+    bool open();
+
+    /**
+     * @brief Unmap the file
+     *
+     * @return void
+     */
+    void close();
+
+    /**
+     * @brief Return the reason of the last failure
+     *
+     * @return QString
+     */
+    const QString &errorString() const { return mErrorString; }
+
+    const QList<Section> &sections() const { return mSections; }
+    const QList<Segment> &segments() const { return mSegments; }
+
+    /**
+     * @brief Find a section by name
+     *
+     * @param name Section name
+     * @return int, the index of the section or -1
+     */
+    int sectionIndex(const QString &name) const;
+
+    /**
+     * @brief Return the contents of a section in the file
+     *
+     * @param section Section
+     * @return const uchar*, NULL if the section has no contents
+     */
+    const uchar *sectionData(const Section &section) const;
+
+    /**
+     * @brief Return a range of the file
+     *
+     * @param offset Offset in the file
+     * @param size Size of the range
+     * @return const uchar*, NULL if the range is outside of the file
+     */
+    const uchar *data(quint32 offset, quint32 size) const;
+
+    /**
+     * @brief Read the symbol table
+     *
+     * @return QList<ElfFile::Symbol>
+     */
+    QList<Symbol> symbols() const;
+
+private:
+    bool fail(const QString &error);
+    QString string(const Section &table, quint32 index) const;
+
+    QFile mFile;
+    const uchar *mData;
+    quint32 mSize;
+    QList<Section> mSections;
+    QList<Segment> mSegments;
+    QString mErrorString;
+};
+
+#endif // ELFFILE_H
@@ -0,0 +1,125 @@
+/*
+  IntelHex.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file IntelHex.cpp
+ * \author Denis Martinez
+ */
+
+#include "IntelHex.h"
+
+#include <QFile>
+
+enum
+{
+    DataRecord = 0x00,
+    EndOfFileRecord = 0x01,
+    ExtendedSegmentAddressRecord = 0x02,
+    ExtendedLinearAddressRecord = 0x04
+};
+
+// bytes per data record, and end of line, as written by avr-objcopy
+static const int recordSize = 16;
+
+IntelHex::IntelHex()
+    : mUpperAddress(0)
+{
+}
+
+void IntelHex::addBlock(quint32 address, const QByteArray &data)
+{
+    int offset = 0;
+    while (offset < data.size())
+    {
+        quint32 upper = address & 0xffff0000;
+        if (upper != mUpperAddress)
+        {
+            char record[2];
+            if (address < 0x100000)
+            {
+                // segment addresses are enough for the first megabyte
+                quint16 segment = upper >> 4;
+                record[0] = segment >> 8;
+                record[1] = segment & 0xff;
+                addRecord(ExtendedSegmentAddressRecord, 0, record, 2);
+            }
+            else
+            {
+                record[0] = upper >> 24;
+                record[1] = (upper >> 16) & 0xff;
+                addRecord(ExtendedLinearAddressRecord, 0, record, 2);
+            }
+            mUpperAddress = upper;
+        }
+
+        // a record never crosses a 64K boundary
+        int size = qMin(recordSize, data.size() - offset);
+        quint32 left = 0x10000 - (address & 0xffff);
+        if (quint32(size) > left)
+            size = left;
+
+        addRecord(DataRecord, address & 0xffff, data.constData() + offset, size);
+        address += size;
+        offset += size;
+    }
+}
+
+QByteArray IntelHex::toByteArray() const
+{
+    return mRecords + ":00000001FF\r\n";
+}
+
+bool IntelHex::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::WriteOnly))
+        return false;
+
+    QByteArray contents = toByteArray();
+    return file.write(contents) == contents.size();
+}
+
+void IntelHex::addRecord(quint8 type, quint16 address, const char *data, int size)
+{
+    static const char digits[] = "0123456789ABCDEF";
+
+    QByteArray record;
+    record.reserve(13 + 2 * size);
+    quint8 checksum = 0;
+    char header[4] = { char(size), char(address >> 8), char(address & 0xff), char(type) };
+
+    record += ':';
+    for (int i = 0; i < 4 + size; i++)
+    {
+        quint8 byte = i < 4 ? header[i] : data[i - 4];
+        checksum += byte;
+        record += digits[byte >> 4];
+        record += digits[byte & 0xf];
+    }
+    checksum = -checksum;
+    record += digits[checksum >> 4];
+    record += digits[checksum & 0xf];
+    record += "\r\n";
+
+    mRecords += record;
+}
@@ -0,0 +1,82 @@
+/*
+  IntelHex.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file IntelHex.h
+ * \author Denis Martinez
+ */
+
+#ifndef INTELHEX_H
+#define INTELHEX_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @brief Writer of Intel HEX files
+ *
+ */
+class IntelHex
+{
+public:
+    /**
+     * @brief Create an empty HEX file, only holding the end of file record
+     *
+     */
+    IntelHex();
+
+    /**
+     * @brief Append a block of data
+     *
+     * Blocks must be added by increasing addresses. Extended segment or
+     * linear address records are inserted when the address crosses 64K.
+     *
+     * @param address Address of the first byte
+     * @param data Data
+     * @return void
+     */
+    void addBlock(quint32 address, const QByteArray &data);
+
+    /**
+     * @brief Return the contents of the file
+     *
+     * @return QByteArray
+     */
+    QByteArray toByteArray() const;
+
+    /**
+     * @brief Save the file
+     *
+     * @param fileName File name
+     * @return bool, True if success or False if not
+     */
+    bool save(const QString &fileName) const;
+
+private:
+    void addRecord(quint8 type, quint16 address, const char *data, int size);
+
+    QByteArray mRecords;
+    quint32 mUpperAddress;
+};
+
+#endif // INTELHEX_H
@@ -0,0 +1,71 @@
+/*
+  Json.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file Json.cpp
+ * \author Denis Martinez
+ */
+
+#include "Json.h"
+
+QByteArray Json::quote(const QString &string)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    QByteArray utf8 = string.toUtf8();
+    QByteArray quoted;
+    quoted.reserve(utf8.size() + 2);
+    quoted += '"';
+    foreach (char c, utf8)
+    {
+        switch (c)
+        {
+        case '"':
+            quoted += "\\\"";
+            break;
+        case '\\':
+            quoted += "\\\\";
+            break;
+        case '\n':
+            quoted += "\\n";
+            break;
+        case '\r':
+            quoted += "\\r";
+            break;
+        case '\t':
+            quoted += "\\t";
+            break;
+        default:
+            if (uchar(c) < 0x20)
+            {
+                quoted += "\\u00";
+                quoted += digits[uchar(c) >> 4];
+                quoted += digits[uchar(c) & 0xf];
+            }
+            else
+                quoted += c;
+        }
+    }
+    quoted += '"';
+    return quoted;
+}
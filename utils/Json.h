@@ -0,0 +1,51 @@
+/*
+  Json.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file Json.h
+ * \author Denis Martinez
+ */
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @brief Helpers to write JSON documents
+ *
+ */
+class Json
+{
+public:
+    /**
+     * @brief Return a string as a quoted JSON string
+     *
+     * @param string String
+     * @return QByteArray, UTF-8 encoded
+     */
+    static QByteArray quote(const QString &string);
+};
+
+#endif // JSON_H
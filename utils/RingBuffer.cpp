@@ -0,0 +1,110 @@
+/*
+  RingBuffer.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file RingBuffer.cpp
+ * \author Denis Martinez
+ */
+
+#include "RingBuffer.h"
+
+#include <cstring>
+
+RingBuffer::RingBuffer(int capacity)
+    : mData(capacity, '\0'),
+      mHead(0),
+      mSize(0)
+{
+}
+
+const char *RingBuffer::readPointer(int *size) const
+{
+    if (mSize == 0)
+    {
+        *size = 0;
+        return NULL;
+    }
+
+    *size = qMin(mSize, capacity() - mHead);
+    return mData.constData() + mHead;
+}
+
+void RingBuffer::free(int size)
+{
+    Q_ASSERT(size >= 0 && size <= mSize);
+    mHead = (mHead + size) % capacity();
+    mSize -= size;
+
+    // start over at the beginning, so that the blocks are as large as possible
+    if (mSize == 0)
+        mHead = 0;
+}
+
+char *RingBuffer::writePointer(int *size)
+{
+    if (mSize == capacity())
+    {
+        *size = 0;
+        return NULL;
+    }
+
+    int tail = mHead + mSize;
+    if (tail < capacity())
+        *size = capacity() - tail;
+    else
+    {
+        tail -= capacity();
+        *size = mHead - tail;
+    }
+    return mData.data() + tail;
+}
+
+void RingBuffer::commit(int size)
+{
+    Q_ASSERT(size >= 0 && size <= freeSpace());
+    mSize += size;
+}
+
+int RingBuffer::read(char *data, int maxSize)
+{
+    int copied = 0;
+    while (copied < maxSize)
+    {
+        int size;
+        const char *block = readPointer(&size);
+        if (block == NULL)
+            break;
+
+        size = qMin(size, maxSize - copied);
+        memcpy(data + copied, block, size);
+        free(size);
+        copied += size;
+    }
+    return copied;
+}
+
+void RingBuffer::clear()
+{
+    mHead = 0;
+    mSize = 0;
+}
@@ -0,0 +1,137 @@
+/*
+  RingBuffer.h
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file RingBuffer.h
+ * \author Denis Martinez
+ */
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <QByteArray>
+
+/**
+ * @brief Byte buffer of a fixed capacity, written and read in place
+ *
+ * The memory is allocated once. The data is accessed as at most two
+ * contiguous blocks, so that it can be filled by a system call and handed
+ * to its consumers without being copied.
+ */
+class RingBuffer
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param capacity Size of the buffer, in bytes
+     */
+    explicit RingBuffer(int capacity);
+
+    /**
+     * @brief Return the size of the buffer
+     *
+     * @return int
+     */
+    int capacity() const { return mData.size(); }
+
+    /**
+     * @brief Return the number of bytes stored
+     *
+     * @return int
+     */
+    int size() const { return mSize; }
+
+    /**
+     * @brief Return True if nothing is stored
+     *
+     * @return bool
+     */
+    bool isEmpty() const { return mSize == 0; }
+
+    /**
+     * @brief Return the number of bytes that can still be stored
+     *
+     * @return int
+     */
+    int freeSpace() const { return capacity() - mSize; }
+
+    /**
+     * @brief Return the oldest contiguous block of data
+     *
+     * The block stays valid until it is freed.
+     *
+     * @param size Filled with the size of the block
+     * @return const char*, NULL if the buffer is empty
+     */
+    const char *readPointer(int *size) const;
+
+    /**
+     * @brief Drop the oldest bytes
+     *
+     * @param size Number of bytes, at most size()
+     * @return void
+     */
+    void free(int size);
+
+    /**
+     * @brief Return the next contiguous free block
+     *
+     * The bytes written to the block are stored by commit().
+     *
+     * @param size Filled with the size of the block
+     * @return char*, NULL if the buffer is full
+     */
+    char *writePointer(int *size);
+
+    /**
+     * @brief Store the bytes written to the block returned by writePointer()
+     *
+     * @param size Number of bytes written
+     * @return void
+     */
+    void commit(int size);
+
+    /**
+     * @brief Copy and drop the oldest bytes
+     *
+     * @param data Destination
+     * @param maxSize Maximum number of bytes
+     * @return int, Number of bytes copied
+     */
+    int read(char *data, int maxSize);
+
+    /**
+     * @brief Drop everything
+     *
+     * @return void
+     */
+    void clear();
+
+private:
+    QByteArray mData;
+    int mHead;
+    int mSize;
+};
+
+#endif // RINGBUFFER_H
@@ -30,6 +30,7 @@ This program is free software; you can redistribute it and/or modify
 #include "Serial.h"
 
 #include <QDebug>
+#include <QMutexLocker>
 
 #include "Compat.h"
 
@@ -37,12 +38,21 @@ This program is free software; you can redistribute it and/or modify
 const Serial::descriptor Serial::INVALID_SERIAL_DESCRIPTOR = INVALID_HANDLE_VALUE;
 #endif
 
+// size of the receive buffer, several times what the drivers hold
+static const int readBufferSize = 64 * 1024;
+
 Serial::Serial(const QString &port, int baudRate)
     : mPort(port),
       mBaudRate(baudRate),
       mSerial(INVALID_SERIAL_DESCRIPTOR),
+      mBuffer(readBufferSize),
       watcher(NULL)
 {
+#if defined(Q_OS_WIN32) || defined(Q_OS_WIN64)
+    mWakeup = NULL;
+#else
+    mWakeup[0] = mWakeup[1] = -1;
+#endif
 }
 
 Serial::~Serial()
@@ -52,7 +62,9 @@ Serial::~Serial()
 
 const QList<int> &Serial::baudRates()
 {
-    static const QList<int> rates = QList<int>() << 300 << 1200 << 2400 << 4800 << 9600 << 19200 << 38400 << 57600 << 115200;
+    static const QList<int> rates = QList<int>()
+        << 300 << 1200 << 2400 << 4800 << 9600 << 19200 << 38400 << 57600 << 115200
+        << 230400 << 250000 << 460800 << 500000 << 921600 << 1000000 << 2000000;
     return rates;
 }
 
@@ -71,18 +83,88 @@ bool Serial::isOpen() const
     return mSerial != INVALID_SERIAL_DESCRIPTOR;
 }
 
+qint64 Serial::readData(char *data, qint64 maxSize)
+{
+    QMutexLocker locker(&mBufferMutex);
+
+    // what was buffered comes first
+    if (! mBuffer.isEmpty())
+        return mBuffer.read(data, int(qMin<qint64>(maxSize, mBuffer.size())));
+    return readPort(data, maxSize);
+}
+
+qint64 Serial::bytesAvailable() const
+{
+    QMutexLocker locker(&mBufferMutex);
+    return mBuffer.size() + qMax<qint64>(0, portBytesAvailable()) + QIODevice::bytesAvailable();
+}
+
 QByteArray Serial::readAll()
 {
-    QByteArray ret;
-    char buf[16];
-    qint64 size;
+    QMutexLocker locker(&mBufferMutex);
 
-    while ((size = readData(buf, 16)) > 0)
-        ret.append(buf, size);
+    // at most one buffer's worth, so that a fast stream can't keep the
+    // caller here forever
+    fill();
 
+    QByteArray ret;
+    ret.reserve(mBuffer.size());
+    int size;
+    const char *block;
+    while ((block = mBuffer.readPointer(&size)) != NULL)
+    {
+        ret.append(block, size);
+        mBuffer.free(size);
+    }
     return ret;
 }
 
+qint64 Serial::fillBuffer()
+{
+    QMutexLocker locker(&mBufferMutex);
+    return fill();
+}
+
+qint64 Serial::fill()
+{
+    qint64 available = portBytesAvailable();
+    if (available < 0)
+        return -1;
+
+    // at most two reads, when the free space wraps around
+    qint64 total = 0;
+    while (available > 0)
+    {
+        int size;
+        char *block = mBuffer.writePointer(&size);
+        if (block == NULL)
+            break;
+
+        qint64 n = readPort(block, qMin<qint64>(size, available));
+        if (n <= 0)
+            return total > 0 ? total : n;
+        mBuffer.commit(n);
+        total += n;
+        available -= n;
+    }
+    return total;
+}
+
+const char *Serial::peekBuffer(qint64 *size) const
+{
+    QMutexLocker locker(&mBufferMutex);
+    int blockSize;
+    const char *block = mBuffer.readPointer(&blockSize);
+    *size = blockSize;
+    return block;
+}
+
+void Serial::consume(qint64 size)
+{
+    QMutexLocker locker(&mBufferMutex);
+    mBuffer.free(int(size));
+}
+
 bool Serial::flushBuffer()
 {
     if (! isOpen())
@@ -108,17 +190,53 @@ void Serial::setInReadEventMode(bool value)
 {
     if (value && watcher==NULL)
     {
+        if (! createWakeup())
+        {
+            qWarning() << "Serial: cannot watch" << mPort;
+            return;
+        }
         watcher = new SerialWatcher(this, this);
         watcher->start();
     }
     else if (!value)
     {
         if (watcher)
+        {
             delete watcher;
+            destroyWakeup();
+        }
         watcher = NULL;
     }
 }
 
+Serial::SerialWatcher::~SerialWatcher()
+{
+    watch = false;
+    serial->wakeUp();
+    wait();
+}
+
+void Serial::SerialWatcher::run()
+{
+    // stops when woken up, or when the port fails, e.g. once unplugged
+    while (watch && serial->waitForData())
+    {
+        if (! watch)
+            break;
+        serial->fillBuffer();
+
+        // each block goes to the receivers as soon as it is peeked, instead
+        // of being gathered first; fillBuffer() only writes to the free space
+        qint64 size;
+        const char *block;
+        while (watch && (block = serial->peekBuffer(&size)) != NULL)
+        {
+            serial->onNewDataArrived(QByteArray(block, int(size)));
+            serial->consume(size);
+        }
+    }
+}
+
 void Serial::onNewDataArrived(QByteArray data)
 {
     emit dataArrived(data);
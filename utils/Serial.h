@@ -32,12 +32,14 @@ This program is free software; you can redistribute it and/or modify
 #include <QIODevice>
 #include <QThread>
 #include <QByteArray>
+#include <QMutex>
 
 #if defined(Q_OS_WIN32) || defined(Q_OS_WIN64)
 #include <windows.h>
 #endif
 
 #include "IDEGlobal.h"
+#include "RingBuffer.h"
 
 class SerialWatcher;
 
@@ -56,6 +58,14 @@ public:
 
     Serial(const QString &port, int baudRate = 9600);
     ~Serial();
+
+    /**
+     * @brief Return the usual baud rates
+     *
+     * Other rates can be used too, where the system supports them.
+     *
+     * @return const QList<int>&
+     */
     static const QList<int> &baudRates();
 
     descriptor serialDescriptor();
@@ -73,17 +83,127 @@ public:
     qint64 readData(char *data, qint64 maxSize);
     qint64 writeData(const char *data, qint64 maxSize);
     bool waitForReadyRead (int msecs);
+    qint64 bytesAvailable() const;
+
+    /**
+     * @brief Read what the port received, at most one buffer's worth
+     *
+     * @return QByteArray
+     */
     QByteArray readAll();
 
+    /**
+     * @brief Move what the port received into the internal buffer
+     *
+     * The driver is asked how much it holds, which is then read in as few
+     * calls as possible. What does not fit in the buffer is left to the
+     * driver.
+     *
+     * @return qint64, Number of bytes read, or -1 on error
+     */
+    qint64 fillBuffer();
+
+    /**
+     * @brief Return the oldest block of buffered data, without copying it
+     *
+     * The block stays valid until consume() is called. Only one thread may
+     * consume the buffer, the watcher in read event mode.
+     *
+     * @param size Filled with the size of the block
+     * @return const char*, NULL if nothing is buffered
+     */
+    const char *peekBuffer(qint64 *size) const;
+
+    /**
+     * @brief Drop the oldest buffered bytes, once peekBuffer() consumers are done with them
+     *
+     * @param size Number of bytes
+     * @return void
+     */
+    void consume(qint64 size);
+
 signals:
     void dataArrived(QByteArray);
 
 private:
     bool setDTR(bool enable);
 
+#if ! defined(Q_OS_WIN32) && ! defined(Q_OS_WIN64)
+    /**
+     * @brief Set a baud rate termios has no constant for, once the port is configured
+     *
+     * Supported on Linux and Mac OS X.
+     *
+     * @return bool, True if success or False with errno set if not
+     */
+    bool setCustomBaudRate();
+#endif
+
+    /**
+     * @brief Implementation of fillBuffer(), with mBufferMutex locked
+     *
+     * @return qint64, Number of bytes read, or -1 on error
+     */
+    qint64 fill();
+
+    /**
+     * @brief Read from the port itself, bypassing the buffer
+     *
+     * @param data Destination
+     * @param maxSize Maximum number of bytes
+     * @return qint64, Number of bytes read, or -1 on error or if nothing was received
+     */
+    qint64 readPort(char *data, qint64 maxSize);
+
+    /**
+     * @brief Return the number of bytes the driver received and holds
+     *
+     * @return qint64, -1 on error
+     */
+    qint64 portBytesAvailable() const;
+
+    /**
+     * @brief Create what wakeUp() uses to interrupt waitForData()
+     *
+     * @return bool, True if success
+     */
+    bool createWakeup();
+
+    /**
+     * @brief Destroy what createWakeup() created
+     *
+     * @return void
+     */
+    void destroyWakeup();
+
+    /**
+     * @brief Block until data can be read, without timeout
+     *
+     * @return bool, True if data may be read or False if woken up or if the port failed
+     */
+    bool waitForData();
+
+    /**
+     * @brief Interrupt waitForData(), from any thread
+     *
+     * @return void
+     */
+    void wakeUp();
+
     QString mPort;
     int mBaudRate;
     descriptor mSerial;
+    RingBuffer mBuffer;
+
+    // the buffer is filled by the watcher and read by the other threads
+    mutable QMutex mBufferMutex;
+
+    // read end and write end of a pipe, or an event on Windows
+#if defined(Q_OS_WIN32) || defined(Q_OS_WIN64)
+    ::HANDLE mWakeup;
+#else
+    int mWakeup[2];
+#endif
 
     void onNewDataArrived(QByteArray data);
 
@@ -93,10 +213,16 @@ private:
      **************************
      **************************
      */
+    /**
+     * @brief Thread reading the data as soon as it arrives
+     *
+     * It sleeps in waitForData() the rest of the time, until the port has
+     * data or the watcher is destroyed.
+     */
     class SerialWatcher : public QThread
     {
     private:
-        bool watch;
+        volatile bool watch;
         Serial* serial;
 
     public:
@@ -104,27 +230,9 @@ private:
                 QThread(parent), watch(true), serial(serial)
         {
         }
-        ~SerialWatcher()
-        {
-            watch = false;
-            wait(1000);
-        }
-
-        void run()
-        {
-            while (serial && watch)
-            {
-                msleep(10);
-                if (serial->waitForReadyRead(300) && watch) {
-                    QByteArray data = serial->readAll();
-                    if (data.length() > 0)
-                        serial->onNewDataArrived(data);
-                }
-            }
-        }
+        ~SerialWatcher();
 
-        void startWatching(bool watch=true) { this->watch = watch; }
-        void stopWatching(){ startWatching(false);}
+        void run();
 
     } *watcher;
     friend class SerialWatcher;
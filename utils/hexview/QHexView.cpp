@@ -38,6 +38,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // #include "CommentServerInterface.h"
 #include "format_address.h"
 
+// the data is stored in blocks of this size, so that the oldest data can be
+// dropped without moving the rest
+static const int chunk_size = 4096;
+
 //------------------------------------------------------------------------------
 // Name: QHexView(QWidget *parent)
 // Desc: constructor
@@ -46,7 +50,7 @@ QHexView::QHexView(QWidget *parent) : QAbstractScrollArea(parent),
                 m_RowWidth(16), m_WordWidth(1), m_AddressColor(Qt::red),
                 m_ShowHex(true), m_ShowAscii(true), m_ShowAddress(true),
                 /* m_ShowComments(true), */ m_Origin(0), m_AddressOffset(0),
-                m_SelectionStart(-1), m_SelectionEnd(-1),
+                m_SelectionStart(-1), m_SelectionEnd(-1), m_Size(0),
                 m_Highlighting(Highlighting_None), m_EvenWord(Qt::blue),
                 m_NonPrintableText(Qt::red), m_UnprintableChar('.'), m_ShowLine1(true),
                 m_ShowLine2(true), m_ShowLine3(true) {
@@ -100,7 +104,15 @@ void QHexView::repaint() {
 // Desc: returns how much data we are viewing
 //------------------------------------------------------------------------------
 int QHexView::dataSize() const {
-        return m_Data != 0 ? m_Data->size() : 0;
+        return m_Size;
+}
+
+//------------------------------------------------------------------------------
+// Name: byteAt(int index) const
+// Desc: returns a byte of the data, all the chunks but the last one are full
+//------------------------------------------------------------------------------
+char QHexView::byteAt(int index) const {
+        return m_Chunks.at(index / chunk_size).at(index % chunk_size);
 }
 
 //------------------------------------------------------------------------------
@@ -222,9 +234,8 @@ void QHexView::mnuSetFont() {
 // Desc: clears all data from the view
 //------------------------------------------------------------------------------
 void QHexView::clear() {
-        if(m_Data != 0) {
-                m_Data->clear();
-        }
+        m_Chunks.clear();
+        m_Size = 0;
 
         repaint();
 }
@@ -447,7 +458,7 @@ void QHexView::scrollTo(unsigned int offset) {
 // Desc: scrolls view to the bottom of the view
 //------------------------------------------------------------------------------
 void QHexView::scrollToBottom() {
-        unsigned int offset = m_Data->length();
+        unsigned int offset = dataSize();
         const int bpr = bytesPerRow();
         m_Origin = offset % bpr;
         address_t address = offset / bpr;
@@ -707,13 +718,94 @@ void QHexView::mouseReleaseEvent(QMouseEvent *event) {
 // Name:
 //------------------------------------------------------------------------------
 void QHexView::setData(const QSharedPointer<C> &d) {
-        m_Data = d;
+        m_Chunks.clear();
+        m_Size = 0;
+        if(d != 0) {
+                for(int i = 0; i < d->size(); i += chunk_size) {
+                        m_Chunks.append(d->mid(i, chunk_size));
+                }
+                m_Size = d->size();
+        }
 
         deselect();
         updateScrollbars();
         repaint();
 }
 
+//------------------------------------------------------------------------------
+// Name: appendData(const C &d)
+// Desc: appends to the current data, only repainting the rows which changed
+//------------------------------------------------------------------------------
+void QHexView::appendData(const C &d) {
+        const unsigned int oldSize = dataSize();
+
+        // fill the last chunk, then start new ones
+        int done = 0;
+        while(done < d.size()) {
+                if(m_Chunks.isEmpty() || m_Chunks.last().size() == chunk_size) {
+                        m_Chunks.append(C());
+                        m_Chunks.last().reserve(chunk_size);
+                }
+
+                C &chunk = m_Chunks.last();
+                const int n = qMin(chunk_size - chunk.size(), d.size() - done);
+                chunk.append(d.constData() + done, n);
+                done += n;
+        }
+        m_Size += d.size();
+        updateScrollbars();
+
+        // the row holding the old end of the data is the first one to change
+        unsigned int offset = verticalScrollBar()->value() * bytesPerRow();
+        if(m_Origin != 0 && offset > 0) {
+                offset += m_Origin;
+                offset -= bytesPerRow();
+        }
+
+        const int row = oldSize > offset ? (oldSize - offset) / bytesPerRow() : 0;
+        const int top = row * m_FontHeight;
+        if(top < viewport()->height()) {
+                viewport()->update(0, top, viewport()->width(), viewport()->height() - top);
+        }
+}
+
+//------------------------------------------------------------------------------
+// Name: removeData(int size)
+// Desc: drops whole chunks of the oldest bytes, the view stays on the same
+//       bytes; returns the number of bytes dropped
+//------------------------------------------------------------------------------
+int QHexView::removeData(int size) {
+        // the last chunk is kept, the others are full
+        const int chunks = qMin(size / chunk_size, m_Chunks.size() - 1);
+        if(chunks <= 0) {
+                return 0;
+        }
+
+        size = chunks * chunk_size;
+        const int rows = size / bytesPerRow();
+        const int value = verticalScrollBar()->value();
+
+        for(int i = 0; i < chunks; ++i) {
+                m_Chunks.removeFirst();
+        }
+        m_Size -= size;
+        m_AddressOffset += size;
+
+        deselect();
+        updateScrollbars();
+        verticalScrollBar()->setValue(value > rows ? value - rows : 0);
+        viewport()->update();
+        return size;
+}
+
+//------------------------------------------------------------------------------
+// Name: isAtBottom() const
+// Desc: returns true if the end of the data is shown
+//------------------------------------------------------------------------------
+bool QHexView::isAtBottom() const {
+        return verticalScrollBar()->value() >= verticalScrollBar()->maximum();
+}
+
 //------------------------------------------------------------------------------
 // Name:
 //------------------------------------------------------------------------------
@@ -775,7 +867,6 @@ bool QHexView::isSelected(int index) const {
 //------------------------------------------------------------------------------
 void QHexView::drawHexDump(QPainter &painter, unsigned int offset, unsigned int row, int &word_count) const {
 
-        const C &dataRef(*m_Data);
         const int size = dataSize();
 
         // i is the word we are currently rendering
@@ -799,32 +890,32 @@ void QHexView::drawHexDump(QPainter &painter, unsigned int offset, unsigned int
 
                         switch(m_WordWidth) {
                         case 1:
-                                value.b |= dataRef[index + 0];
+                                value.b |= byteAt(index + 0);
                                 byteBuffer.sprintf("%02x", value.b);
                                 break;
                         case 2:
-                                value.w |= dataRef[index + 0];
-                                value.w |= dataRef[index + 1] << 8;
+                                value.w |= byteAt(index + 0);
+                                value.w |= byteAt(index + 1) << 8;
                                 byteBuffer.sprintf("%04x", value.w);
                                 break;
                         case 4:
-                                value.d |= dataRef[index + 0];
-                                value.d |= dataRef[index + 1] << 8;
-                                value.d |= dataRef[index + 2] << 16;
-                                value.d |= dataRef[index + 3] << 24;
+                                value.d |= byteAt(index + 0);
+                                value.d |= byteAt(index + 1) << 8;
+                                value.d |= byteAt(index + 2) << 16;
+                                value.d |= byteAt(index + 3) << 24;
                                 byteBuffer.sprintf("%08x", value.d);
                                 break;
                         case 8:
                                 // we need the cast to ensure that it won't assume 32-bit
                                 // and drop bits shifted more that 31
-                                value.q |= static_cast<quint64>(dataRef[index + 0]);
-                                value.q |= static_cast<quint64>(dataRef[index + 1]) << 8;
-                                value.q |= static_cast<quint64>(dataRef[index + 2]) << 16;
-                                value.q |= static_cast<quint64>(dataRef[index + 3]) << 24;
-                                value.q |= static_cast<quint64>(dataRef[index + 4]) << 32;
-                                value.q |= static_cast<quint64>(dataRef[index + 5]) << 40;
-                                value.q |= static_cast<quint64>(dataRef[index + 6]) << 48;
-                                value.q |= static_cast<quint64>(dataRef[index + 7]) << 56;
+                                value.q |= static_cast<quint64>(byteAt(index + 0));
+                                value.q |= static_cast<quint64>(byteAt(index + 1)) << 8;
+                                value.q |= static_cast<quint64>(byteAt(index + 2)) << 16;
+                                value.q |= static_cast<quint64>(byteAt(index + 3)) << 24;
+                                value.q |= static_cast<quint64>(byteAt(index + 4)) << 32;
+                                value.q |= static_cast<quint64>(byteAt(index + 5)) << 40;
+                                value.q |= static_cast<quint64>(byteAt(index + 6)) << 48;
+                                value.q |= static_cast<quint64>(byteAt(index + 7)) << 56;
                                 byteBuffer.sprintf("%016llx", value.q);
                                 break;
                         }
@@ -881,7 +972,6 @@ void QHexView::drawHexDump(QPainter &painter, unsigned int offset, unsigned int
 //------------------------------------------------------------------------------
 void QHexView::drawAsciiDump(QPainter &painter, unsigned int offset, unsigned int row) const {
 
-        const C &dataRef(*m_Data);
         const int size = dataSize();
 
         // i is the byte index
@@ -893,7 +983,7 @@ void QHexView::drawAsciiDump(QPainter &painter, unsigned int offset, unsigned in
 
                 if(index < size) {
 
-                        const char ch = dataRef[index];
+                        const char ch = byteAt(index);
                         const int drawLeft = asciiDumpLeft() + i * m_FontWidth;
                         const bool printable = isPrintable(ch);
 
@@ -935,7 +1025,7 @@ void QHexView::drawAsciiDump(QPainter &painter, unsigned int offset, unsigned in
 //------------------------------------------------------------------------------
 // Name: paintEvent(QPaintEvent *)
 //------------------------------------------------------------------------------
-void QHexView::paintEvent(QPaintEvent *) {
+void QHexView::paintEvent(QPaintEvent *event) {
 
         QPainter painter(viewport());
 
@@ -957,7 +1047,17 @@ void QHexView::paintEvent(QPaintEvent *) {
                 }
         }
 
-        while(row + m_FontHeight < static_cast<unsigned int>(height()) && offset < static_cast<unsigned int>(dataSize())) {
+        // rows outside of the updated area are skipped
+        const int bottom = event->rect().bottom();
+
+        while(row + m_FontHeight < static_cast<unsigned int>(height()) && static_cast<int>(row) <= bottom && offset < static_cast<unsigned int>(dataSize())) {
+
+                if(static_cast<int>(row + m_FontHeight) <= event->rect().top()) {
+                        word_count += m_RowWidth;
+                        offset += bytesPerRow();
+                        row += m_FontHeight;
+                        continue;
+                }
 
                 if(m_ShowAddress) {
                         const address_t addressRVA = m_AddressOffset + offset;
@@ -1018,11 +1118,10 @@ void QHexView::deselect() {
 //------------------------------------------------------------------------------
 QByteArray QHexView::allBytes() const {
         QByteArray ret;
-        const C &dataRef(*m_Data);
         const int size = dataSize();
 
         for(int i = 0; i < size; ++i) {
-                ret.push_back(dataRef[i]);
+                ret.push_back(byteAt(i));
         }
 
         return ret;
@@ -1033,12 +1132,11 @@ QByteArray QHexView::allBytes() const {
 //------------------------------------------------------------------------------
 QByteArray QHexView::selectedBytes() const {
         QByteArray ret;
-        const C &dataRef(*m_Data);
         const int size = dataSize();
 
         for(int i = 0; i < size; ++i) {
                 if(isSelected(i)) {
-                        ret.push_back(dataRef[i]);
+                        ret.push_back(byteAt(i));
                 }
         }
 
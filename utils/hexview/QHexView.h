@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include <QAbstractScrollArea>
 #include <QByteArray>
+#include <QList>
 #include <QMap>
 #include <QString>
 #include <QSharedPointer>
@@ -95,9 +96,14 @@ private:
         // bool m_ShowComments;
 
 public:
-        QSharedPointer<C> data() const { return m_Data; }
+        // a copy of the data, which is stored in chunks
+        QSharedPointer<C> data() const { return QSharedPointer<C>(new C(allBytes())); }
+        int dataSize() const;
 
         void setData(const QSharedPointer<C> &d);
+        void appendData(const C &d);
+        int removeData(int size);
+        bool isAtBottom() const;
         void setAddressOffset(address_t offset);
         void scrollTo(unsigned int offset);
         void scrollToBottom();
@@ -135,7 +141,7 @@ private:
 
         unsigned int bytesPerRow() const;
 
-        int dataSize() const;
+        char byteAt(int index) const;
 
         void drawAsciiDump(QPainter &painter, unsigned int offset, unsigned int row) const;
         void drawHexDump(QPainter &painter, unsigned int offset, unsigned int row, int &word_count) const;
@@ -154,7 +160,8 @@ private:
         int m_SelectionEnd;			// index of last selected word (or -1)
         int m_FontWidth;			// width of a character in this font
         int m_FontHeight;			// height of a character in this font
-        QSharedPointer<C> m_Data;	// the current data
+        QList<C> m_Chunks;			// the current data, in chunks
+        int m_Size;				// size of the current data
 
         enum {
                 Highlighting_None,
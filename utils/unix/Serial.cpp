@@ -39,6 +39,47 @@ This program is free software; you can redistribute it and/or modify
 
 #include <QDebug>
 
+/**
+ * @brief Return the termios constant of a baud rate
+ *
+ * @param baudRate Baud rate
+ * @return speed_t, B0 if there is none
+ */
+static speed_t standardBaudRate(int baudRate)
+{
+    switch (baudRate)
+    {
+    case 300: return B300;
+    case 1200: return B1200;
+    case 2400: return B2400;
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+#ifdef B230400
+    case 230400: return B230400;
+#endif
+#ifdef B460800
+    case 460800: return B460800;
+#endif
+#ifdef B500000
+    case 500000: return B500000;
+#endif
+#ifdef B921600
+    case 921600: return B921600;
+#endif
+#ifdef B1000000
+    case 1000000: return B1000000;
+#endif
+#ifdef B2000000
+    case 2000000: return B2000000;
+#endif
+    default: return B0;
+    }
+}
+
 bool Serial::open(OpenMode mode)
 {
     if (isOpen())
@@ -47,19 +88,11 @@ bool Serial::open(OpenMode mode)
         return false;
     }
 
-    int realBaudRate;
-    switch (mBaudRate)
+    // the rates without a constant are set once the port is configured
+    speed_t realBaudRate = standardBaudRate(mBaudRate);
+    speed_t initialBaudRate = realBaudRate != B0 ? realBaudRate : B38400;
+    if (mBaudRate <= 0)
     {
-    case 300: realBaudRate = B300; break;
-    case 1200: realBaudRate = B1200; break;
-    case 2400: realBaudRate = B2400; break;
-    case 4800: realBaudRate = B4800; break;
-    case 9600: realBaudRate = B9600; break;
-    case 19200: realBaudRate = B19200; break;
-    case 38400: realBaudRate = B38400; break;
-    case 57600: realBaudRate = B57600; break;
-    case 115200: realBaudRate = B115200; break;
-    default:
         setErrorString(tr("Unknown baud rate %0").arg(mBaudRate));
         return false;
     }
@@ -81,13 +114,15 @@ bool Serial::open(OpenMode mode)
     struct termios serial_params;
     if (::tcgetattr(mSerial, &serial_params) == -1)
         goto error;
-    if (::cfsetispeed(&serial_params, realBaudRate) == -1)
+    if (::cfsetispeed(&serial_params, initialBaudRate) == -1)
         goto error;
-    if (::cfsetospeed(&serial_params, realBaudRate) == -1)
+    if (::cfsetospeed(&serial_params, initialBaudRate) == -1)
         goto error;
     cfmakeraw(&serial_params);
     if (::tcsetattr(mSerial, TCSANOW, &serial_params) == -1)
         goto error;
+    if (realBaudRate == B0 && ! setCustomBaudRate())
+        goto error;
 
     setOpenMode(mode);
     return true;
@@ -107,14 +142,16 @@ void Serial::close()
     if (isOpen())
     {
         emit aboutToClose();
+        // the watcher must not poll a closed descriptor
+        setInReadEventMode(false);
         ::close(mSerial);
+        mSerial = -1;
         setOpenMode(NotOpen);
         setErrorString(QString());
-        setInReadEventMode(false);
     }
 }
 
-qint64 Serial::readData(char *data, qint64 maxSize)
+qint64 Serial::readPort(char *data, qint64 maxSize)
 {
     ssize_t n = ::read(mSerial, data, maxSize);
     if (n > 0)
@@ -124,6 +161,14 @@ qint64 Serial::readData(char *data, qint64 maxSize)
    return -1;
 }
 
+qint64 Serial::portBytesAvailable() const
+{
+    int available = 0;
+    if (::ioctl(mSerial, FIONREAD, &available) == -1)
+        return -1;
+    return available;
+}
+
 qint64 Serial::writeData(const char *data, qint64 maxSize)
 {
     ssize_t n = ::write(mSerial, data, maxSize);
@@ -141,11 +186,75 @@ bool Serial::waitForReadyRead (int msecs)
 {
     struct pollfd pfd;
     pfd.fd = serialDescriptor();
-    pfd.events |= POLLIN;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int rv;
+    do
+        rv = poll(&pfd, 1, msecs);
+    while (rv == -1 && errno == EINTR);
+
+    return rv > 0 && (pfd.revents & POLLIN);
+}
+
+bool Serial::createWakeup()
+{
+    if (::pipe(mWakeup) == -1)
+    {
+        mWakeup[0] = mWakeup[1] = -1;
+        return false;
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        ::fcntl(mWakeup[i], F_SETFL, O_NONBLOCK);
+        ::fcntl(mWakeup[i], F_SETFD, FD_CLOEXEC);
+    }
+    return true;
+}
+
+void Serial::destroyWakeup()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (mWakeup[i] >= 0)
+            ::close(mWakeup[i]);
+        mWakeup[i] = -1;
+    }
+}
+
+bool Serial::waitForData()
+{
+    struct pollfd pfd[2];
+    pfd[0].fd = mSerial;
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    pfd[1].fd = mWakeup[0];
+    pfd[1].events = POLLIN;
+    pfd[1].revents = 0;
 
-    int rv = poll(&pfd, 1, msecs);
+    int rv;
+    do
+        rv = poll(pfd, 2, -1);
+    while (rv == -1 && errno == EINTR);
+
+    if (rv <= 0 || pfd[1].revents != 0)
+        return false;
+    // a port that went away keeps reporting errors, don't spin on it
+    if (pfd[0].revents & (POLLERR | POLLHUP | POLLNVAL))
+        return false;
+    return (pfd[0].revents & POLLIN) != 0;
+}
 
-    return rv > 0;
+void Serial::wakeUp()
+{
+    if (mWakeup[1] >= 0)
+    {
+        char byte = 0;
+        ssize_t n;
+        do
+            n = ::write(mWakeup[1], &byte, 1);
+        while (n == -1 && errno == EINTR);
+    }
 }
 
 bool Serial::setDTR(bool enable)
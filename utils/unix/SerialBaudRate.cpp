@@ -0,0 +1,60 @@
+/*
+  SerialBaudRate.cpp
+
+  This file is part of arduide, The Qt-based IDE for the open-source Arduino electronics prototyping platform.
+
+  Copyright (C) 2010-2016
+  Authors : Denis Martinez
+	    Martin Peres
+
+This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file SerialBaudRate.cpp
+ * \author Denis Martinez
+ */
+
+#include "../Serial.h"
+
+#include <cerrno>
+#include <sys/ioctl.h>
+
+// this file does not include termios.h, whose definitions conflict with
+// the ones of the kernel
+#if defined(Q_OS_LINUX)
+#include <asm/termbits.h>
+#elif defined(Q_OS_DARWIN)
+#include <IOKit/serial/ioss.h>
+#endif
+
+bool Serial::setCustomBaudRate()
+{
+#if defined(Q_OS_LINUX)
+    struct termios2 params;
+    if (::ioctl(mSerial, TCGETS2, &params) == -1)
+        return false;
+    params.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    params.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    params.c_ispeed = mBaudRate;
+    params.c_ospeed = mBaudRate;
+    return ::ioctl(mSerial, TCSETS2, &params) != -1;
+#elif defined(Q_OS_DARWIN)
+    speed_t speed = mBaudRate;
+    return ::ioctl(mSerial, IOSSIOSPEED, &speed) != -1;
+#else
+    errno = EINVAL;
+    return false;
+#endif
+}
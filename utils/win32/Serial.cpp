@@ -37,22 +37,14 @@ bool Serial::open(OpenMode mode)
         return false;
     }
 
-    DWORD dwBaudRate;
-    switch (mBaudRate)
+    // the driver takes any rate the hardware supports, the CBR_ constants
+    // are the rates themselves
+    if (mBaudRate <= 0)
     {
-    case 300: dwBaudRate = CBR_300; break;
-    case 1200: dwBaudRate = CBR_1200; break;
-    case 2400: dwBaudRate = CBR_2400; break;
-    case 4800: dwBaudRate = CBR_4800; break;
-    case 9600: dwBaudRate = CBR_9600; break;
-    case 19200: dwBaudRate = CBR_19200; break;
-    case 38400: dwBaudRate = CBR_38400; break;
-    case 57600: dwBaudRate = CBR_57600; break;
-    case 115200: dwBaudRate = CBR_115200; break;
-    default:
         setErrorString(tr("Unknown baud rate %0").arg(mBaudRate));
         return false;
     }
+    DWORD dwBaudRate = mBaudRate;
 
     DWORD dwMode = 0;
     if (mode & ReadOnly)
@@ -95,14 +87,16 @@ void Serial::close()
     if (isOpen())
     {
         emit aboutToClose();
+        // the watcher must not wait on a closed handle
+        setInReadEventMode(false);
         ::CloseHandle(mSerial);
+        mSerial = INVALID_SERIAL_DESCRIPTOR;
         setOpenMode(NotOpen);
         setErrorString(QString());
-        setInReadEventMode(false);
     }
 }
 
-qint64 Serial::readData(char *data, qint64 maxSize)
+qint64 Serial::readPort(char *data, qint64 maxSize)
 {
     DWORD dwRead;
     if (! ::ReadFile(mSerial, data, maxSize, &dwRead, NULL))
@@ -119,6 +113,15 @@ error:
     return -1;
 }
 
+qint64 Serial::portBytesAvailable() const
+{
+    COMSTAT stat;
+    DWORD errors;
+    if (! ::ClearCommError(mSerial, &errors, &stat))
+        return -1;
+    return stat.cbInQue;
+}
+
 qint64 Serial::writeData(const char *data, qint64 maxSize)
 {
     DWORD dwWritten;
@@ -141,6 +144,62 @@ bool Serial::waitForReadyRead (int msecs)
     return false;
 }
 
+bool Serial::createWakeup()
+{
+    mWakeup = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+    return mWakeup != NULL;
+}
+
+void Serial::destroyWakeup()
+{
+    if (mWakeup != NULL)
+        ::CloseHandle(mWakeup);
+    mWakeup = NULL;
+}
+
+bool Serial::waitForData()
+{
+    // the characters received before the wait don't raise EV_RXCHAR
+    COMSTAT stat;
+    DWORD errors;
+    if (::ClearCommError(mSerial, &errors, &stat) && stat.cbInQue > 0)
+        return true;
+
+    if (! ::SetCommMask(mSerial, EV_RXCHAR))
+        return false;
+
+    OVERLAPPED overlapped;
+    ZeroMemory(&overlapped, sizeof(overlapped));
+    overlapped.hEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (overlapped.hEvent == NULL)
+        return false;
+
+    bool ready = false;
+    DWORD mask = 0;
+    DWORD transferred;
+    if (::WaitCommEvent(mSerial, &mask, &overlapped))
+        ready = true;
+    else if (::GetLastError() == ERROR_IO_PENDING)
+    {
+        HANDLE handles[2] = { overlapped.hEvent, mWakeup };
+        if (::WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0)
+            ready = ::GetOverlappedResult(mSerial, &overlapped, &transferred, FALSE) != FALSE;
+        else
+        {
+            ::CancelIo(mSerial);
+            ::GetOverlappedResult(mSerial, &overlapped, &transferred, TRUE);
+        }
+    }
+    ::CloseHandle(overlapped.hEvent);
+    return ready;
+}
+
+void Serial::wakeUp()
+{
+    if (mWakeup != NULL)
+        ::SetEvent(mWakeup);
+}
+
 bool Serial::setDTR(bool enable)
 {
     if (! isOpen())